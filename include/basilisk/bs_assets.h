@@ -0,0 +1,30 @@
+#ifndef BS_ASSETS_H
+#define BS_ASSETS_H
+
+#include <bs_core.h>
+#include <bs_shaders.h>
+
+typedef enum {
+    BS_ASSET_MODEL,
+    BS_ASSET_TEXTURE,
+    BS_ASSET_SHADER,
+} bs_AssetType;
+
+/* --- REGISTRY --- */
+// Assets are keyed by path, acquiring a loaded one only bumps its reference count
+// Shared assets must not be modified, per object state goes into a bs_ModelInstance
+// NULL is returned if a model can't be loaded, nothing is registered for it then
+// Texture and shader loaders don't report failure, those are always registered
+bs_Model  *bs_acquireModel(char *path, char *texture_folder_path);
+bs_Tex2D  *bs_acquireTexture(char *path, int frames);
+// Encoded images that don't come from a file, name has to be unique like a path
+bs_Tex2D  *bs_acquireTextureData(char *name, const unsigned char *png, size_t size, int frames);
+bs_Shader *bs_acquireShader(char *vs_path, char *fs_path, char *gs_path);
+
+// Frees the asset once nothing references it anymore
+// Textures are owned by their atlas and stay registered so they're never packed twice
+void bs_releaseAsset(void *asset);
+int bs_getAssetRefCount(void *asset);
+int bs_getAssetCount();
+
+#endif /* BS_ASSETS_H */
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef BS_CORE_H
 #define BS_CORE_H
 
+#include <stdint.h>
 #include <bs_shaders.h>
 #include <cglm/cglm.h>
 
@@ -144,15 +145,58 @@ typedef struct {
 	unsigned int VAO, VBO, EBO;
 } bs_Batch;
 
-typedef struct bs_Joint bs_Joint;
 typedef struct {
-	bs_Joint *joints;
-	int joint_count;
+	bs_vec3 translation;
+	bs_vec4 rotation;
+	bs_vec3 scale;
+} bs_Transform;
+
+typedef enum {
+	BS_CHANNEL_TRANSLATION,
+	BS_CHANNEL_ROTATION,
+	BS_CHANNEL_SCALE,
+	BS_CHANNEL_WEIGHTS,
+} bs_ChannelPath;
+
+typedef enum {
+	BS_INTERP_LINEAR,
+	BS_INTERP_STEP,
+	BS_INTERP_CUBIC,
+} bs_Interpolation;
+
+// Keyframes of one property of one joint or node or the morph weights of one mesh, quantized to 16 bit values
+typedef struct {
+	int target; // glTF node the channel animates, meshes map it to their own joint through node_joints
+	int node; // Index into the model nodes, -1 if the target was folded away or isn't a node
+	int mesh; // Mesh whose morph weights are animated, -1 for joint channels
+	int path;
+	int interpolation; // Linear or step, cubic splines are resampled at load
+
+	int key_count;
+	// Values per key, three for joints and the target count of the mesh for weights
+	int components;
+	// Fraction of the clip duration
+	uint16_t *times;
+	// Smallest-three rotations or fixed point values within min and min + extent (weights only use x)
+	uint16_t *values;
+	bs_vec3 min;
+	bs_vec3 extent;
+} bs_Channel;
+
+typedef struct {
+	bs_Channel *channels;
+	int channel_count;
+
+	// Seconds, the time of the last key
+	float duration;
 } bs_Anim;
 
+typedef struct bs_Joint bs_Joint;
+
 typedef struct {
 	bs_RGBA base_color;
 	bs_Tex2D *tex;
+	int tex_index; // Index into the models textures, -1 if untextured
 
 	bs_vec3 specular;
 } bs_Material;
@@ -163,11 +207,24 @@ struct bs_Joint {
 	bs_mat4 local_inv;
 	bs_mat4 bind_matrix;
 	bs_mat4 bind_matrix_inv;
+	// bind_matrix * local_inv, the constant front of the skinning chain
+	bs_mat4 bind_local_inv;
 
 	bs_Joint *parent;
-	int loc;
+	// Levels below the mesh root, animation LOD drops the deepest ones
+	int depth;
+
+	// Local transform when no clip animates the joint
+	bs_Transform rest;
 };
 
+// A vertex moved by a morph target, the deltas are half floats
+typedef struct {
+	int vertex;
+	uint16_t position[3];
+	uint16_t normal[3];
+} bs_MorphDelta;
+
 typedef struct {
 	bs_Material material;
 	int attrib_count;
@@ -177,31 +234,90 @@ typedef struct {
 
 	int *indices;
 	int index_count;
+
+	// Sparse morph targets, only the vertices a target moves are stored
+	// Target i owns deltas target_starts[i] to target_starts[i + 1]
+	bs_MorphDelta *deltas;
+	int *target_starts;
+	int delta_count;
 } bs_Prim;
 
 typedef struct {
 	int vertex_count;
 
-	bs_vec3 pos;
-	bs_vec4 rot;
-	bs_vec3 sca;
+	// Model node that moves the mesh, -1 if its world transform is baked into the vertices.
+	// Skinned meshes follow the node of their skeleton through the pose
+	int node;
 
 	bs_Prim *prims;
 	int prim_count;
 
 	bs_Joint *joints;
 	int joint_count;
+	// Joint indices with every parent ahead of its children
+	int *joint_order;
+	// Joint of every glTF node up to the last one in the skin, -1 for nodes outside of it
+	int *node_joints;
+	int node_joint_count;
+
+	// Morph targets shared by every prim and their weights when no clip animates them
+	int target_count;
+	float *weights;
 } bs_Mesh;
 
+// Scene graph node kept for animated and skinned meshes, the static rest is folded away at load
+typedef struct {
+	// Static transforms between the parent and the node, from the model root for top level nodes
+	bs_mat4 offset;
+	// Local transform when no clip animates the node
+	bs_Transform rest;
+	// Nodes come after their parent, -1 at the top
+	int parent;
+} bs_Node;
+
 typedef struct {
 	bs_Mesh *meshes;
 	bs_Tex2D **textures;
+	bs_Anim *anims;
+	bs_Node *nodes;
 
 	int mesh_count;
+	int tex_count;
+	int anim_count;
+	int node_count;
 	int vertex_count;
 	int index_count;
+
+	// Everything above points into one block, either the mapped binary cache or an arena
+	void *cache_data;
+	size_t cache_size;
+	void *arena;
 } bs_Model;
 
+// Per object state of a shared model
+typedef struct {
+	bs_Model *model;
+
+	bs_vec3 pos;
+	bs_vec4 rot;
+	bs_vec3 sca;
+
+	// Joint matrices of every mesh back to back in mesh order, then the world matrix of every node
+	bs_mat4 *pose;
+	int pose_count;
+
+	// Clip the pose is evaluated from, NULL keeps the current pose
+	bs_Anim *anim;
+	float time;
+
+	// Morph weights of every mesh back to back in mesh order
+	float *weights;
+	int weight_count;
+
+	// Animation detail for bs_animateInstances, 0 is full detail (bs_setAnimLod)
+	int lod;
+} bs_ModelInstance;
+
 /* --- RENDERING --- */
 void bs_createFramebuffer(bs_Framebuffer *framebuffer, int render_width, int render_height, void (*render)(), bs_Shader *shader);
 void bs_setFramebufferShader(bs_Framebuffer *framebuffer, bs_Shader *shader);
@@ -0,0 +1,113 @@
+#ifndef BS_CROWDS_H
+#define BS_CROWDS_H
+
+#include <bs_core.h>
+#include <bs_shaders.h>
+#include <bs_morphs.h>
+
+typedef struct {
+    bs_mat4 matrix;
+    float time;
+} bs_VertexAnimInstance;
+
+// Texture units the joint palettes and vertex animations are bound to while a crowd renders
+#define BS_CROWD_PALETTE_UNIT 15
+#define BS_VERTEX_ANIM_UNIT 14
+
+// Crowds, vertex animations and skin passes map their UVs into the atlas when they're created,
+// so they're created once the atlas is pushed (bs_startRender), earlier their geometry stays empty
+
+// Every instance of one skinned model drawn with a single instanced call
+// The vertex shader gets the rig attributes of bs_RVertex at locations 0-5 and
+// "in int bs_PaletteOffset" at location 6, bone i of the instance is the mat4 at texels
+// (bs_PaletteOffset + i) * 4 to + 3 of "samplerBuffer bs_JointPalette", the instance transform is already applied
+typedef struct {
+    bs_Model *model;
+    bs_Shader *shader;
+
+    // Skinned prims of the model merged into one vertex and index buffer
+    unsigned int VAO, VBO, EBO;
+    int index_count;
+
+    // Palette offset of every instance pushed this frame
+    unsigned int instance_VBO;
+    int *offsets;
+    int instance_count;
+    int instance_capacity;
+
+    bs_PaletteBuffer palettes;
+} bs_Crowd;
+
+// One clip of a skinned model baked into a float texture, nothing is posed on the CPU when it plays
+// Every frame takes "int bs_VertexAnimRows" rows of "int bs_VertexAnimWidth" texels, so vertex v (gl_VertexID)
+// of frame f is at texel (v % width, f * rows + v / width) of "sampler2D bs_VertexAnim" and its normal
+// at (v % width, (frame_count + f) * rows + v / width).
+// "int bs_VertexAnimFrames" and "float bs_VertexAnimDuration" describe the clip, frame f is sampled at
+// f * duration / (frames - 1) so a time t maps to frame t / duration * (frames - 1).
+// Instances give "in float bs_InstanceTime" at location 6 and "in mat4 bs_InstanceMatrix" at locations 7-10
+typedef struct {
+    bs_Model *model;
+    bs_Shader *shader;
+
+    unsigned int texture;
+    int vertex_count;
+    int frame_count;
+    float duration;
+
+    // Vertices wrap onto more rows when there are more than GL_MAX_TEXTURE_SIZE
+    int width;
+    int rows;
+
+    unsigned int VAO, VBO, EBO;
+    int index_count;
+
+    unsigned int instance_VBO;
+    bs_VertexAnimInstance *instances;
+    int instance_count;
+    int instance_capacity;
+} bs_VertexAnim;
+
+// Skins an instance once per frame with transform feedback, every render pass after that
+// (main view, shadow map, reflections) draws the result as static bs_Vertex geometry
+// The skinning shader is loaded with bs_loadSkinShader, it reads the same inputs as a crowd
+// with bs_JointOffset as a uniform and writes "out vec3 bs_OutPosition", "out vec2 bs_OutTexCoord",
+// "out vec3 bs_OutNormal" and "flat out uint bs_OutColor" (RGBA bytes, red lowest).
+// Morph targets are blended in the same shader from bs_MorphDeltas and bs_MorphWeights before skinning
+typedef struct {
+    bs_Model *model;
+    bs_Shader *shader;
+
+    // Rig geometry that is skinned
+    unsigned int src_VAO, src_VBO;
+    int vertex_count;
+
+    // Skinned vertices in world space, drawn with the rig index buffer
+    unsigned int VAO, VBO, EBO;
+    int index_count;
+
+    bs_PaletteBuffer palettes;
+    bs_MorphBuffer morphs;
+} bs_SkinPass;
+
+void bs_createCrowd(bs_Crowd *crowd, bs_Model *model, bs_Shader *shader);
+void bs_freeCrowd(bs_Crowd *crowd);
+
+void bs_clearCrowd(bs_Crowd *crowd);
+void bs_pushCrowdInstance(bs_Crowd *crowd, bs_ModelInstance *instance);
+void bs_renderCrowd(bs_Crowd *crowd, bs_Camera *camera);
+
+float *bs_bakeVertexAnim(bs_Model *model, bs_Anim *anim, float fps, int *vertex_count, int *frame_count);
+void bs_createVertexAnim(bs_VertexAnim *vertex_anim, bs_Model *model, bs_Anim *anim, float fps, bs_Shader *shader);
+void bs_freeVertexAnim(bs_VertexAnim *vertex_anim);
+
+void bs_loadSkinShader(char *vs_path, bs_Shader *shader);
+void bs_createSkinPass(bs_SkinPass *pass, bs_Model *model, bs_Shader *shader);
+void bs_freeSkinPass(bs_SkinPass *pass);
+void bs_runSkinPass(bs_SkinPass *pass, bs_ModelInstance *instance);
+void bs_renderSkinPass(bs_SkinPass *pass, bs_Shader *shader, bs_Camera *camera);
+
+void bs_clearVertexAnim(bs_VertexAnim *vertex_anim);
+void bs_pushVertexAnimInstance(bs_VertexAnim *vertex_anim, bs_mat4 matrix, float time);
+void bs_renderVertexAnim(bs_VertexAnim *vertex_anim, bs_Camera *camera);
+
+#endif /* BS_CROWDS_H */
\ No newline at end of file
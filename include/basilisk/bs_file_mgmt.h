@@ -1,7 +1,13 @@
 #ifndef BS_FILE_MGMT
 #define BS_FILE_MGMT
 
+#include <stddef.h>
+
 char* bs_readFileToString(char *path, int *errcode);
 void bs_appendToFile(const char *filepath, const char *data);
 
+void *bs_mapFile(char *path, size_t *size);
+void bs_unmapFile(void *data, size_t size);
+long long bs_getFileTime(char *path);
+
 #endif /* BS_FILE_MGMT */
\ No newline at end of file
@@ -0,0 +1,10 @@
+#ifndef BS_JOBS_H
+#define BS_JOBS_H
+
+// Runs fn(i, arg) for every i in [0, count) across the worker threads
+// Returns once every index has finished, the calling thread helps out
+// Nested calls from inside a job run serially on the calling worker
+void bs_parallelFor(int count, void (*fn)(int index, void *arg), void *arg);
+int bs_getWorkerCount();
+
+#endif /* BS_JOBS_H */
\ No newline at end of file
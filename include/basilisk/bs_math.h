@@ -1,7 +1,17 @@
 #ifndef BS_MATH_H
 #define BS_MATH_H
 
+#include <stdint.h>
+#include <stddef.h>
+
+#define BS_MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define BS_MIN(x, y) (((x) < (y)) ? (x) : (y))
+
 int bs_sign(float x);
 double bs_fMap(double input, double input_start, double input_end, double output_start, double output_end);
+uint64_t bs_hash64(const void *data, size_t len, uint64_t seed);
+
+uint16_t bs_floatToHalf(float value);
+float bs_halfToFloat(uint16_t half);
 
 #endif /* BS_MATH_H */
\ No newline at end of file
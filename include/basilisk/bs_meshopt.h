@@ -0,0 +1,18 @@
+#ifndef BS_MESHOPT_H
+#define BS_MESHOPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Decoders for the meshoptimizer codecs of EXT_meshopt_compression, false if the data is malformed
+bool bs_decodeVertexBuffer(void *dst, size_t count, size_t stride, const uint8_t *src, size_t size);
+bool bs_decodeIndexBuffer(void *dst, size_t count, size_t index_size, const uint8_t *src, size_t size);
+bool bs_decodeIndexSequence(void *dst, size_t count, size_t index_size, const uint8_t *src, size_t size);
+
+// Filters run in place on decoded vertex data
+void bs_decodeOctFilter(void *data, size_t count, size_t stride);
+void bs_decodeQuatFilter(void *data, size_t count);
+void bs_decodeExpFilter(void *data, size_t count, size_t stride);
+
+#endif /* BS_MESHOPT_H */
\ No newline at end of file
@@ -3,8 +3,15 @@
 
 #include <bs_core.h>
 
-void bs_loadModel(char *model_path, char *texture_folder_path, bs_Model *model);
-void bs_animate(bs_Mesh *mesh, bs_Anim *anim, int frame);
-bs_Anim *bs_getAnims();
+bool bs_loadModel(char *model_path, char *texture_folder_path, bs_Model *model);
+void bs_convertModel(char *model_path, char *cache_path);
+void bs_freeModel(bs_Model *model);
+bool bs_areModelTexturesPacked(bs_Model *model);
+
+void bs_createModelInstance(bs_ModelInstance *instance, bs_Model *model);
+void bs_freeModelInstance(bs_ModelInstance *instance);
+bs_mat4 *bs_getInstancePose(bs_ModelInstance *instance, int mesh_index);
+void bs_getInstanceMatrix(bs_ModelInstance *instance, bs_mat4 matrix);
+void bs_getInstanceMeshMatrix(bs_ModelInstance *instance, int mesh_index, bs_mat4 matrix);
 
 #endif /* BS_MODELS_H */
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef BS_MORPHS_H
+#define BS_MORPHS_H
+
+#include <bs_core.h>
+#include <bs_shaders.h>
+
+// Texture units the morph deltas and weights are bound to while a skin pass runs
+#define BS_MORPH_DELTA_UNIT 13
+#define BS_MORPH_WEIGHT_UNIT 12
+
+// Morph targets of the skinned meshes in the vertex order of bs_Crowd and bs_SkinPass, for the vertex shader
+// Texel t of "samplerBuffer bs_MorphDeltas" holds (first texel, delta count) of target t (bs_ModelInstance.weights),
+// every delta is two texels: (position delta, vertex) and (normal delta, 0), sorted by vertex within a target.
+// Texel 0 of "samplerBuffer bs_MorphWeights" holds the number of active targets, the texels after it (target, weight).
+// The shader walks the active targets only and binary searches gl_VertexID in their deltas.
+typedef struct {
+    unsigned int delta_buffer, delta_texture;
+    unsigned int weight_buffer, weight_texture;
+
+    int delta_count;
+    int weight_count;
+
+    // Active target list of the last upload, laid out like bs_MorphWeights
+    float *active;
+    int active_count;
+} bs_MorphBuffer;
+
+void bs_morphPrim(bs_Prim *prim, float *weights, int target_count, bs_RVertex *vertices);
+
+void bs_createMorphBuffer(bs_MorphBuffer *morphs, bs_Model *model);
+void bs_freeMorphBuffer(bs_MorphBuffer *morphs);
+void bs_uploadMorphWeights(bs_MorphBuffer *morphs, float *weights);
+void bs_setMorphUniforms(bs_Shader *shader, bs_MorphBuffer *morphs);
+
+#endif /* BS_MORPHS_H */
\ No newline at end of file
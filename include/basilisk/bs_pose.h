@@ -0,0 +1,39 @@
+#ifndef BS_POSE_H
+#define BS_POSE_H
+
+#include <stdint.h>
+#include <bs_core.h>
+
+// Instances posed by one job of bs_animateInstances
+#define BS_POSE_BATCH_SIZE 16
+// Levels of bs_setAnimLod, see anim_lod_rates and anim_lod_depths
+#define BS_ANIM_LOD_COUNT 4
+
+// Key quantization, shared with the loader
+void bs_packQuat(float *rotation, uint16_t *packed);
+void bs_unpackQuat(uint16_t *packed, float *rotation);
+void bs_packVec3(float *vector, bs_vec3 *min, bs_vec3 *extent, uint16_t *packed);
+void bs_unpackVec3(uint16_t *packed, bs_vec3 *min, bs_vec3 *extent, float *vector);
+
+void bs_getTransformMatrix(bs_Transform *transform, bs_mat4 matrix);
+void bs_sortJoints(bs_Mesh *mesh);
+
+void bs_sampleAnimDepth(bs_Mesh *mesh, bs_Anim *anim, float time, int max_depth, bs_Transform *locals);
+void bs_sampleAnim(bs_Mesh *mesh, bs_Anim *anim, float time, bs_Transform *locals);
+void bs_sampleWeights(bs_Model *model, bs_Anim *anim, float time, float *weights);
+void bs_sampleNodes(bs_Model *model, bs_Anim *anim, float time, bs_Transform *locals);
+float bs_wrapAnimTime(bs_Anim *anim, float time);
+void bs_animateDepth(bs_Mesh *mesh, bs_Anim *anim, float time, int max_depth, bs_mat4 *pose);
+void bs_animate(bs_Mesh *mesh, bs_Anim *anim, float time, bs_mat4 *pose);
+void bs_animateNodes(bs_Model *model, bs_Anim *anim, float time, bs_mat4 *matrices);
+void bs_animateModel(bs_Model *model, bs_Anim *anim, float time, int max_depth, bs_mat4 *pose);
+
+void bs_setAnimLod(bs_ModelInstance *instance, float screen_size);
+void bs_releasePoses(bs_Model *model);
+
+// Poses every skinned mesh and node of the instances with their own clip and time,
+// the batch version shares poses between instances in sync and honours their LOD
+void bs_animateInstance(bs_ModelInstance *instance);
+void bs_animateInstances(bs_ModelInstance *instances, int instance_count);
+
+#endif /* BS_POSE_H */
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef BS_RESIDENCY_H
+#define BS_RESIDENCY_H
+
+#include <stddef.h>
+#include <bs_textures.h>
+
+// Frames an atlas can go unused before it's evicted instead of downgraded
+#define BS_EVICT_AGE 120
+// Mip levels an atlas can be dropped by before it's evicted
+#define BS_MAX_DOWNGRADE 2
+
+typedef struct {
+    size_t budget;
+    size_t gpu_bytes;
+    size_t cpu_bytes;
+
+    int resident_count;
+    int downgraded_count;
+    int evicted_count;
+
+    // Atlas bytes saved by sharing identical textures
+    size_t dedup_bytes_saved;
+} bs_ResidencyStats;
+
+/* --- RESIDENCY --- */
+// Only atlases with a cache (bs_setAtlasCache) can be evicted, 0 disables the budget
+void bs_setTextureBudget(size_t bytes);
+void bs_markAtlasUsed(bs_Atlas *atlas);
+void bs_markTextureUsed(bs_Tex2D *tex);
+void bs_updateResidency();
+
+size_t bs_getAtlasGPUBytes(bs_Atlas *atlas);
+size_t bs_getAtlasCPUBytes(bs_Atlas *atlas);
+size_t bs_getTextureBytes(bs_Tex2D *tex);
+bs_ResidencyStats bs_getResidencyStats();
+
+#endif /* BS_RESIDENCY_H */
\ No newline at end of file
@@ -8,6 +8,11 @@ typedef enum {
 	UNIFORM_PROJ,
 	UNIFORM_VIEW,
 	UNIFORM_TIME,
+	UNIFORM_JOINTS,
+	UNIFORM_JOINT_PALETTE,
+	UNIFORM_JOINT_OFFSET,
+	UNIFORM_MORPH_DELTAS,
+	UNIFORM_MORPH_WEIGHTS,
 
 	UNIFORM_TYPE_COUNT,
 } bs_STDUniforms;
@@ -30,9 +35,25 @@ typedef struct {
 	unsigned int gs_id;
 } bs_Shader;
 
+// Joint palettes of many skinned meshes packed into one texture buffer
+// Shaders read them from "samplerBuffer bs_JointPalette", four texels per matrix starting at bs_JointOffset
+typedef struct {
+	unsigned int buffer;
+	unsigned int texture;
+
+	float (*data)[4][4];
+	int count;
+	int capacity;
+	// Matrices the GPU buffer has room for
+	int buffer_capacity;
+} bs_PaletteBuffer;
+
 // INITIALIZATION
 void bs_loadMemShader(char *vs_code, char *fs_code, char *gs_code, bs_Shader *shader);
 void bs_loadShader(char *vs_path, char *fs_path, char *gs_path, bs_Shader *shader);
+void bs_loadMemFeedbackShader(char *vs_code, const char **varyings, int varying_count, bs_Shader *shader);
+void bs_loadFeedbackShader(char *vs_path, const char **varyings, int varying_count, bs_Shader *shader);
+void bs_freeShader(bs_Shader *shader);
 
 void bs_setShaderAtlas(bs_Shader *shader, bs_Atlas *atlas, char *uniform_name);
 
@@ -40,12 +61,24 @@ void bs_setShaderAtlas(bs_Shader *shader, bs_Atlas *atlas, char *uniform_name);
 void bs_setTimeUniform(bs_Shader *shader, float time);
 void bs_setViewMatrixUniform(bs_Shader *shader, void *cam);
 void bs_setProjMatrixUniform(bs_Shader *shader, void *cam);
+void bs_setJointsUniform(bs_Shader *shader, float (*pose)[4][4], int count);
+void bs_setJointOffsetUniform(bs_Shader *shader, int offset);
+void bs_setPaletteUniform(bs_Shader *shader, bs_PaletteBuffer *palettes, int unit);
+
+// JOINT PALETTES
+void bs_createPaletteBuffer(bs_PaletteBuffer *palettes);
+void bs_freePaletteBuffer(bs_PaletteBuffer *palettes);
+void bs_clearPalettes(bs_PaletteBuffer *palettes);
+int bs_pushPalette(bs_PaletteBuffer *palettes, float (*pose)[4][4], int count);
+void bs_uploadPalettes(bs_PaletteBuffer *palettes);
 
 // SHADER ABSTRACTION LAYER
 int bs_getUniformLoc(bs_Shader *shader, char *name);
 void bs_switchShader(bs_Shader *shader);
 
 void bs_uniform_mat4(int loc, float mat[4][4]);
+void bs_uniform_mat4_array(int loc, float (*mats)[4][4], int count);
+void bs_uniform_int(int loc, int val);
 void bs_uniform_float(int loc, float val);
 
 #endif /* BS_SHADERS_H */
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef BS_STATICS_H
+#define BS_STATICS_H
+
+#include <bs_core.h>
+#include <bs_shaders.h>
+
+// Edge length in world units of the cells static triangles are sorted into
+#define BS_STATIC_CHUNK_SIZE 32.0
+
+// A model placed in the level before the merge, only its static meshes are taken
+typedef struct {
+    bs_Model *model;
+    bs_Shader *shader;
+    bs_mat4 matrix;
+} bs_StaticPlacement;
+
+// Triangles of one cell, culled against the camera as a whole
+typedef struct {
+    bs_vec3 min, max;
+    int index_offset;
+    int index_count;
+} bs_StaticChunk;
+
+// Every static prim drawn with the same shader and atlas, pre-transformed into world space
+// Vertices use the bs_Vertex layout of a normal batch, chunks are contiguous in the index buffer
+typedef struct {
+    bs_Shader *shader;
+    int atlas_id;
+
+    // Only kept until the group is uploaded
+    bs_Vertex *vertices;
+    int vertex_count;
+    int vertex_capacity;
+    int *indices;
+    int index_count;
+    int index_capacity;
+
+    bs_StaticChunk *chunks;
+    int chunk_count;
+
+    // Marked used whenever the group draws so residency keeps the atlas in
+    bs_Tex2D **textures;
+    int texture_count;
+
+    unsigned int VAO, VBO, EBO;
+
+    // Index ranges of the visible chunks, neighbouring chunks share a range
+    int *range_counts;
+    void **range_offsets;
+} bs_StaticGroup;
+
+// The static environment of a level merged by shader and atlas into a few draw calls
+// UVs are mapped into the atlas rects when merging, so it's built after bs_pushAtlas (bs_startRender)
+typedef struct {
+    float chunk_size;
+
+    bs_StaticPlacement *placements;
+    int placement_count;
+    int placement_capacity;
+
+    bs_StaticGroup *groups;
+    int group_count;
+
+    // Chunk ranges drawn by the last render
+    int drawn_ranges;
+} bs_StaticLevel;
+
+bool bs_isStaticMesh(bs_Mesh *mesh);
+
+void bs_createStaticLevel(bs_StaticLevel *level, float chunk_size);
+void bs_pushStaticModel(bs_StaticLevel *level, bs_Model *model, bs_mat4 matrix, bs_Shader *shader);
+bool bs_mergeStaticLevel(bs_StaticLevel *level);
+bool bs_buildStaticLevel(bs_StaticLevel *level);
+void bs_freeStaticLevel(bs_StaticLevel *level);
+
+int bs_cullStaticGroup(bs_StaticGroup *group, vec4 planes[6]);
+void bs_renderStaticLevel(bs_StaticLevel *level, bs_Camera *camera);
+
+#endif /* BS_STATICS_H */
\ No newline at end of file
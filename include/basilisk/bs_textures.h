@@ -1,28 +1,111 @@
 #ifndef BS_TEXTURES_H
 #define BS_TEXTURES_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BS_MAX_MIP_LEVELS 16
+
+// Storage format of an atlas on the GPU, chosen per atlas before pushing
+// R8 keeps alpha only and RG8 keeps luminance + alpha, both sample as white tinted textures
+typedef enum {
+    BS_TEX_RGBA8 = 0,
+    BS_TEX_R8,
+    BS_TEX_RG8,
+    BS_TEX_RGB565,
+    BS_TEX_BC1,
+    BS_TEX_BC3,
+
+    BS_TEX_FORMAT_COUNT,
+} bs_TexFormat;
+
+typedef struct {
+    int internal_format;
+    int format;
+    int type;
+
+    // Uncompressed formats use 1x1 blocks
+    int block_dim;
+    int block_bytes;
+} bs_TexFormatInfo;
+
 typedef struct {
     unsigned int w, h;
     unsigned int x, y;
     float tex_x, tex_y;
     float tex_wx, tex_hy;
+
+    // Points into the decoded image until the atlas is pushed, rows are data_stride pixels apart
     unsigned char *data;
+    int data_stride;
+
+    int atlas_id;
+    int last_used;
 } bs_Tex2D;
 
 typedef struct {
     int w, h;
+    int max_w, max_h;
     int id;
     unsigned int tex_id;
     unsigned char *data;
 
     int tex_count;
-    bs_Tex2D *textures;
+    int tex_capacity;
+    bs_Tex2D **textures;
+
+    // Decoded images referenced by the textures, freed once the atlas is built
+    unsigned char **sheets;
+    int sheet_count;
+
+    // The texture pixels are dropped once they're packed, so an atlas is only pushed once
+    bool pushed;
+
+    // Textures that share the placement of an identical one
+    int dedup_count;
+    size_t dedup_bytes_saved;
+
+    // Encoded mip chain, filled in when the atlas is pushed
+    bs_TexFormat format;
+    char *cache_path;
+    unsigned char *baked;
+    size_t baked_size;
+    int level_count;
+    size_t level_offsets[BS_MAX_MIP_LEVELS];
+    uint64_t content_hash;
+
+    // First mip level that is on the GPU, -1 if the atlas is evicted
+    int resident_level;
+    int last_used;
+
+    // Texture that replaces tex_id once its uploads finish, pending_level is -1 if there is none
+    unsigned int pending_tex_id;
+    int pending_level;
+
+    // Set by draws of a downgraded or evicted atlas, the restore happens in bs_updateResidency
+    bool restore_requested;
+    // The cache couldn't be read back, cleared when the atlas is pushed or gets a new cache
+    bool restore_failed;
 } bs_Atlas;
 
 /* --- TEXTURES --- */
 bs_Atlas *bs_createTextureAtlas(int width, int height, int max_textures);
 bs_Tex2D *bs_loadTexture(char *path, int frames);
+bs_Tex2D *bs_loadTextureData(const unsigned char *png, size_t size, int frames);
+void bs_addAtlasTexture(bs_Atlas *atlas, bs_Tex2D *tex);
 void bs_selectTexture(bs_Tex2D *texture);
+bool bs_isTexturePacked(bs_Tex2D *tex);
+void bs_setAtlasFormat(bs_Atlas *atlas, bs_TexFormat format);
+void bs_setAtlasCache(bs_Atlas *atlas, char *path);
+const bs_TexFormatInfo *bs_getFormatInfo(bs_TexFormat format);
+size_t bs_getFormatSize(bs_TexFormat format, int w, int h);
+void bs_bakeAtlas(bs_Atlas *atlas);
+unsigned char *bs_readAtlasLevels(bs_Atlas *atlas, int first_level);
+size_t bs_getAtlasLevelBytes(bs_Atlas *atlas, int first_level);
+void bs_streamAtlasLevels(bs_Atlas *atlas, unsigned char *levels, int first_level);
+int bs_getAtlasCount();
+bs_Atlas *bs_getAtlas(int id);
 void bs_pushAtlas(bs_Atlas *atlas);
 void bs_saveAtlasToFile(bs_Atlas *atlas, char *name);
 void bs_freeAtlasData(bs_Atlas *atlas);
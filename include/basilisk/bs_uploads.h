@@ -0,0 +1,37 @@
+#ifndef BS_UPLOADS_H
+#define BS_UPLOADS_H
+
+#include <stddef.h>
+#include <bs_textures.h>
+
+#define BS_UPLOAD_RING_SIZE 3
+#define BS_UPLOAD_PBO_BYTES (4 << 20)
+#define BS_UPLOAD_DEFAULT_BUDGET (8 << 20)
+// Texture unit the upload queue binds its textures to
+#define BS_UPLOAD_UNIT 11
+
+typedef struct {
+    unsigned int tex_id;
+    int level;
+    int w, h;
+    bs_TexFormat format;
+
+    unsigned char *data;
+    int next_row;
+
+    // Called once the last row is sent, free_ptr is freed right after
+    void (*done)(void *arg);
+    void *arg;
+    void *free_ptr;
+} bs_Upload;
+
+/* --- TEXTURE UPLOADS --- */
+// Queues a full mip level, the texture storage has to exist already
+void bs_queueUpload(unsigned int tex_id, int level, int w, int h, bs_TexFormat format, unsigned char *data,
+                    void (*done)(void *arg), void *arg, void *free_ptr);
+void bs_setUploadBudget(size_t bytes_per_frame);
+void bs_processUploads();
+void bs_flushUploads();
+int bs_getPendingUploadCount();
+
+#endif /* BS_UPLOADS_H */
\ No newline at end of file
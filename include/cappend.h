@@ -17,9 +17,9 @@ typedef struct {
 #define cappend_MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define cappend_MIN(x, y) (((x) < (y)) ? (x) : (y))
 #include <stdio.h>
-// Appends image data to another image
-void cappend_append(unsigned char *dest, int dest_w, int dest_h, 
-					unsigned char *src, int src_w, int src_h,
+// Appends image data to another image, src rows are src_stride pixels apart
+void cappend_appendStrided(unsigned char *dest, int dest_w, int dest_h, 
+					unsigned char *src, int src_w, int src_h, int src_stride,
 					int x_offset, int y_offset) {
 
 	// For each horizontal row in src image
@@ -31,59 +31,131 @@ void cappend_append(unsigned char *dest, int dest_w, int dest_h,
 		write_offset += 4 * y_offset * dest_w;
 
 		int read_offset = 0;
-		read_offset += i * 4 * src_w;
+		read_offset += i * 4 * src_stride;
 
 		memcpy(dest + write_offset, src + read_offset, 4 * src_w);
 	}
 
 }
 
+// Appends image data to another image
+void cappend_append(unsigned char *dest, int dest_w, int dest_h, 
+					unsigned char *src, int src_w, int src_h,
+					int x_offset, int y_offset) {
+
+	cappend_appendStrided(dest, dest_w, dest_h, src, src_w, src_h, src_w, x_offset, y_offset);
+}
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+// Bitmask of the pixels with non-zero alpha among the 16 RGBA pixels at p
+int cappend_alphaMask16(const unsigned char *p) {
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+	const __m128i zero  = _mm_setzero_si128();
+	int mask = 0;
+
+	for(int i = 0; i < 4; i++) {
+		__m128i px = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+		__m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(px, alpha), zero);
+		mask |= (~_mm_movemask_ps(_mm_castsi128_ps(transparent)) & 0xF) << (4 * i);
+	}
+
+	return mask;
+}
+#endif
+
+// First pixel in [from, to) of a row with non-zero alpha, to if there is none
+int cappend_firstOpaque(const unsigned char *row, int from, int to) {
+	int x = from;
+
+#if defined(__SSE2__)
+	for(; x + 16 <= to; x += 16) {
+		int mask = cappend_alphaMask16(row + 4 * x);
+		if(mask != 0)
+			return x + __builtin_ctz(mask);
+	}
+#endif
+
+	for(; x < to; x++) {
+		if(row[4 * x + 3] != 0)
+			return x;
+	}
+
+	return to;
+}
+
+// Last pixel in [from, to) of a row with non-zero alpha, from - 1 if there is none
+int cappend_lastOpaque(const unsigned char *row, int from, int to) {
+	int x = to;
+
+#if defined(__SSE2__)
+	for(; x - 16 >= from; x -= 16) {
+		int mask = cappend_alphaMask16(row + 4 * (x - 16));
+		if(mask != 0)
+			return x - 16 + (31 - __builtin_clz(mask));
+	}
+#endif
+
+	for(; x > from; x--) {
+		if(row[4 * (x - 1) + 3] != 0)
+			return x - 1;
+	}
+
+	return from - 1;
+}
+
+// Gets the smallest possible size of a region inside a larger image without losing quality
+// Rows of the region are stride pixels apart, returns 1 if it is completely transparent
+int cappend_getMinimumTextureSizeStrided(unsigned char *data, int old_w, int old_h, int stride, cappend_ImgInfo *img_info) {
+	int row_size = 4 * stride;
+	int top = 0;
+	int bottom = old_h - 1;
+
+	// Walk in from the top and bottom edges until a row has a visible pixel
+	while(top < old_h && cappend_firstOpaque(data + top * row_size, 0, old_w) == old_w) {
+		top++;
+	}
+
+	// If texture is completely transparent
+	if(top == old_h) {
+		*img_info = (cappend_ImgInfo){ 0, 0, 0, 0, 0, 0 };
+		return 1;
+	}
+
+	while(cappend_firstOpaque(data + bottom * row_size, 0, old_w) == old_w) {
+		bottom--;
+	}
+
+	// Each row only has to be scanned up to the current left and right bounds
+	int left = old_w;
+	int right = -1;
+	for(int y = top; y <= bottom; y++) {
+		unsigned char *row = data + y * row_size;
+
+		left  = cappend_firstOpaque(row, 0, left);
+		right = cappend_MAX(right, cappend_lastOpaque(row, right + 1, old_w));
+
+		if(left == 0 && right == old_w - 1)
+			break;
+	}
+
+	right++;
+	bottom++;
+
+	*img_info = (cappend_ImgInfo){ left, right, bottom, top, (right - left), (bottom - top) };
+
+	return 0;
+}
+
 // Gets a textures smallest possible size without losing quality
 // Returns 1 if texture is completely transparent
 int cappend_getMinimumTextureSize(unsigned char *data, int old_w, int old_h, cappend_ImgInfo *img_info) {
-    int left   = old_w;
-    int right  = 0;
-    int bottom = 0;
-    int top    = old_h;
-
-    // For each pixel in texture
-    for(int y = 0; y < old_h * 4; y += 4) {
-        for(int x = 0; x < old_w * 4; x += 4) {
-            int index = x + (y * old_w);
-            unsigned char A = data[index+3];
-
-            // If pixel is not transparent
-            if(A != 0) {
-                left   = cappend_MIN(left,   x / 4);
-                right  = cappend_MAX(right,  x / 4);
-                bottom = cappend_MAX(bottom, y / 4);
-                top    = cappend_MIN(top,    y / 4);
-            }
-        }
-    }
-
-    // If texture is completely transparent
-    if(right == 0 &&
-        bottom == 0 &&
-        left == old_w &&
-        top == old_h) {
-
-        left = right = top = bottom = 0;
-        *img_info = (cappend_ImgInfo){ left, right, bottom, top, 0, 0 };
-        return 1;
-    }
-
-    right++;
-    bottom++;
-
-    *img_info = (cappend_ImgInfo){ left, right, bottom, top, (right - left), (bottom - top) };
-
-    return 0;
+	return cappend_getMinimumTextureSizeStrided(data, old_w, old_h, old_w, img_info);
 }
 
+// Moves the trimmed region to the start of the buffer, rows never overlap forwards
 void cappend_removePixelsByExtent(unsigned char **data, int data_w, int data_h, cappend_ImgInfo *img_info) {
-	unsigned char *new_data = malloc(4 * img_info->w * img_info->h);
-
 	// For each horizontal row in image
 	for(int i = img_info->top; i < img_info->bottom; i++) {
 		int write_offset = 4 * (i - img_info->top) * img_info->w;
@@ -91,11 +163,8 @@ void cappend_removePixelsByExtent(unsigned char **data, int data_w, int data_h,
 		int read_offset = 4 * i * data_w;
 		read_offset += 4 * img_info->left;
 
-		memcpy(new_data + write_offset, *data + read_offset, 4 * img_info->w);
+		memmove(*data + write_offset, *data + read_offset, 4 * img_info->w);
 	}
-
-	free(*data);
-	*data = new_data;
 }
 
 #endif /* CAPPEND_H */
\ No newline at end of file
@@ -8,6 +8,9 @@ typedef struct {
 	int x, y;
 	float tex_x, tex_y;
 
+	// Only set for rects that got a spot in the atlas
+	bool placed;
+
 	int id;
 } rectpacker_Rect;
 
@@ -23,14 +26,26 @@ int cmpId(const void *s1, const void *s2) {
     return r1->id - r2->id;
 }
 
-void rectpacker_packRect(rectpacker_Rect *rects, int rect_count, int atlas_width, int atlas_height) {
+// Returns the number of rects that didn't fit
+int rectpacker_packRect(rectpacker_Rect *rects, int rect_count, int atlas_width, int atlas_height) {
+	int placed = 0;
+	int empty = 0;
+
+	if(rect_count == 0)
+		return 0;
+
 	// Setting default values
 	for(int i = 0; i < rect_count; i++) {
 		rects[i].x = 0;
 		rects[i].y = 0;
 		rects[i].tex_x = 0.0;
 		rects[i].tex_y = 0.0;
+		rects[i].placed = false;
 		rects[i].id = i;
+
+		// Empty rects are never placed but always fit
+		if(rects[i].w == 0 || rects[i].h == 0)
+			empty++;
 	}
 
 	// Sort by a heuristic
@@ -53,7 +68,7 @@ void rectpacker_packRect(rectpacker_Rect *rects, int rect_count, int atlas_width
 		}
 
 		// If outside the range of the atlas
-		if((y_pos + rects[i].h) > atlas_height)
+		if((y_pos + rects[i].h) > atlas_height || rects[i].w > atlas_width)
 			break;
 
 
@@ -61,6 +76,7 @@ void rectpacker_packRect(rectpacker_Rect *rects, int rect_count, int atlas_width
 		rects[i].y = y_pos;
 		rects[i].tex_x = x_pos / (float)atlas_width;
 		rects[i].tex_y = y_pos / (float)atlas_height;
+		rects[i].placed = true;
 
 		// Optimization test
 		// if(i != 0) {
@@ -69,7 +85,10 @@ void rectpacker_packRect(rectpacker_Rect *rects, int rect_count, int atlas_width
 		// }
 
 		x_pos += rects[i].w;
+		placed++;
 	}
 	
 	qsort(rects, rect_count, sizeof(rectpacker_Rect), cmpId);
+
+	return rect_count - placed - empty;
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+// Basilisk
+#include <bs_assets.h>
+#include <bs_models.h>
+#include <bs_textures.h>
+#include <bs_shaders.h>
+#include <bs_math.h>
+
+// STD
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define BS_MIN_ASSET_SLOTS 64
+
+typedef struct {
+    uint64_t hash;
+    char *key;
+    bs_AssetType type;
+
+    void *data;
+    int ref_count;
+
+    // Set while the first thread to acquire it is loading it
+    bool loading;
+} bs_Asset;
+
+// Textures are read from path, or decoded from png when it's set
+typedef struct {
+    char *path;
+    int frames;
+    const unsigned char *png;
+    size_t png_size;
+} bs_TextureSource;
+
+typedef struct {
+    char *path;
+    char *texture_folder_path;
+} bs_ModelSource;
+
+typedef struct {
+    char *vs_path;
+    char *fs_path;
+    char *gs_path;
+} bs_ShaderPaths;
+
+// Open addressing with linear probing, entries are individually allocated so they survive a resize
+bs_Asset **asset_slots = NULL;
+int asset_slot_count = 0;
+int asset_count = 0;
+
+pthread_mutex_t asset_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t asset_cond = PTHREAD_COND_INITIALIZER;
+
+int bs_assetSlot(uint64_t hash) {
+    return hash & (asset_slot_count - 1);
+}
+
+bs_Asset *bs_findAsset(bs_AssetType type, char *key, uint64_t hash) {
+    if(asset_slot_count == 0)
+        return NULL;
+
+    for(int i = bs_assetSlot(hash); asset_slots[i] != NULL; i = (i + 1) & (asset_slot_count - 1)) {
+        bs_Asset *asset = asset_slots[i];
+
+        if(asset->hash == hash && asset->type == type && strcmp(asset->key, key) == 0)
+            return asset;
+    }
+
+    return NULL;
+}
+
+void bs_placeAsset(bs_Asset *asset) {
+    int i = bs_assetSlot(asset->hash);
+    while(asset_slots[i] != NULL) {
+        i = (i + 1) & (asset_slot_count - 1);
+    }
+
+    asset_slots[i] = asset;
+}
+
+void bs_insertAsset(bs_Asset *asset) {
+    // Stay under 3/4 load
+    if((asset_count + 1) * 4 > asset_slot_count * 3) {
+        bs_Asset **old_slots = asset_slots;
+        int old_count = asset_slot_count;
+
+        asset_slot_count = BS_MAX(BS_MIN_ASSET_SLOTS, asset_slot_count * 2);
+        asset_slots = calloc(asset_slot_count, sizeof(bs_Asset *));
+
+        for(int i = 0; i < old_count; i++) {
+            if(old_slots[i] != NULL)
+                bs_placeAsset(old_slots[i]);
+        }
+
+        free(old_slots);
+    }
+
+    bs_placeAsset(asset);
+    asset_count++;
+}
+
+// Backward shift deletion, keeps every probe chain intact without tombstones
+void bs_removeAsset(bs_Asset *asset) {
+    int i = bs_assetSlot(asset->hash);
+    while(asset_slots[i] != asset) {
+        i = (i + 1) & (asset_slot_count - 1);
+    }
+
+    for(int j = (i + 1) & (asset_slot_count - 1); asset_slots[j] != NULL; j = (j + 1) & (asset_slot_count - 1)) {
+        int home = bs_assetSlot(asset_slots[j]->hash);
+
+        // Move the entry back if its home slot isn't cyclically within (i, j]
+        bool movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+        if(movable) {
+            asset_slots[i] = asset_slots[j];
+            i = j;
+        }
+    }
+
+    asset_slots[i] = NULL;
+    asset_count--;
+}
+
+// Only looked up when releasing, so a scan is fine
+bs_Asset *bs_findAssetData(void *data) {
+    for(int i = 0; i < asset_slot_count; i++) {
+        if(asset_slots[i] != NULL && asset_slots[i]->data == data && !asset_slots[i]->loading)
+            return asset_slots[i];
+    }
+
+    return NULL;
+}
+
+void bs_freeAssetEntry(bs_Asset *asset) {
+    free(asset->key);
+    free(asset);
+}
+
+// Returns NULL if loading failed, failed assets aren't kept so the next acquire tries again
+void *bs_acquireAsset(bs_AssetType type, char *key, void *(*load)(char *key, void *arg), void *arg) {
+    uint64_t hash = bs_hash64(key, strlen(key), type);
+
+    pthread_mutex_lock(&asset_mutex);
+    bs_Asset *asset = bs_findAsset(type, key, hash);
+
+    if(asset != NULL) {
+        asset->ref_count++;
+
+        while(asset->loading) {
+            pthread_cond_wait(&asset_cond, &asset_mutex);
+        }
+
+        void *data = asset->data;
+        bool last = data == NULL && --asset->ref_count == 0;
+        pthread_mutex_unlock(&asset_mutex);
+
+        if(last)
+            bs_freeAssetEntry(asset);
+        return data;
+    }
+
+    asset = calloc(1, sizeof(bs_Asset));
+    asset->hash = hash;
+    asset->key = strdup(key);
+    asset->type = type;
+    asset->ref_count = 1;
+    asset->loading = true;
+    bs_insertAsset(asset);
+
+    // Loading happens unlocked so assets can acquire their own dependencies
+    pthread_mutex_unlock(&asset_mutex);
+    void *data = load(key, arg);
+
+    pthread_mutex_lock(&asset_mutex);
+    asset->data = data;
+    asset->loading = false;
+
+    // Threads waiting on it still hold the entry, the last one to let go frees it
+    bool last = false;
+    if(data == NULL) {
+        bs_removeAsset(asset);
+        last = --asset->ref_count == 0;
+    }
+
+    pthread_cond_broadcast(&asset_cond);
+    pthread_mutex_unlock(&asset_mutex);
+
+    if(last)
+        bs_freeAssetEntry(asset);
+    return data;
+}
+
+void *bs_loadModelAsset(char *key, void *arg) {
+    bs_ModelSource *source = arg;
+    bs_Model *model = malloc(sizeof(bs_Model));
+
+    if(!bs_loadModel(source->path, source->texture_folder_path, model)) {
+        free(model);
+        return NULL;
+    }
+
+    return model;
+}
+
+void *bs_loadTextureAsset(char *key, void *arg) {
+    bs_TextureSource *source = arg;
+
+    if(source->png != NULL)
+        return bs_loadTextureData(source->png, source->png_size, source->frames);
+
+    return bs_loadTexture(source->path, source->frames);
+}
+
+void *bs_loadShaderAsset(char *key, void *arg) {
+    bs_ShaderPaths *paths = arg;
+    bs_Shader *shader = malloc(sizeof(bs_Shader));
+
+    bs_loadShader(paths->vs_path, paths->fs_path, paths->gs_path, shader);
+    return shader;
+}
+
+bs_Model *bs_acquireModel(char *path, char *texture_folder_path) {
+    // Textures come from the folder, so the same model with another folder is another asset
+    char key[768];
+    snprintf(key, sizeof(key), "%s|%s", path, texture_folder_path == NULL ? "" : texture_folder_path);
+
+    bs_ModelSource source = { path, texture_folder_path };
+    return bs_acquireAsset(BS_ASSET_MODEL, key, bs_loadModelAsset, &source);
+}
+
+bs_Tex2D *bs_acquireTexture(char *path, int frames) {
+    // The same sheet split differently is a different asset
+    char key[512];
+    snprintf(key, sizeof(key), "%s:%d", path, frames);
+
+    bs_TextureSource source = { path, frames, NULL, 0 };
+    return bs_acquireAsset(BS_ASSET_TEXTURE, key, bs_loadTextureAsset, &source);
+}
+
+bs_Tex2D *bs_acquireTextureData(char *name, const unsigned char *png, size_t size, int frames) {
+    char key[512];
+    snprintf(key, sizeof(key), "%s:%d", name, frames);
+
+    // The bytes are only read if this is the first acquire
+    bs_TextureSource source = { name, frames, png, size };
+    return bs_acquireAsset(BS_ASSET_TEXTURE, key, bs_loadTextureAsset, &source);
+}
+
+bs_Shader *bs_acquireShader(char *vs_path, char *fs_path, char *gs_path) {
+    char key[768];
+    snprintf(key, sizeof(key), "%s|%s|%s", vs_path, fs_path, gs_path == NULL ? "" : gs_path);
+
+    bs_ShaderPaths paths = { vs_path, fs_path, gs_path };
+    return bs_acquireAsset(BS_ASSET_SHADER, key, bs_loadShaderAsset, &paths);
+}
+
+void bs_releaseAsset(void *data) {
+    pthread_mutex_lock(&asset_mutex);
+    bs_Asset *asset = bs_findAssetData(data);
+
+    if(asset == NULL || --asset->ref_count > 0 || asset->type == BS_ASSET_TEXTURE) {
+        pthread_mutex_unlock(&asset_mutex);
+        return;
+    }
+
+    bs_removeAsset(asset);
+    pthread_mutex_unlock(&asset_mutex);
+
+    switch(asset->type) {
+        case BS_ASSET_MODEL:
+            bs_freeModel(asset->data);
+            break;
+        case BS_ASSET_SHADER:
+            bs_freeShader(asset->data);
+            break;
+        default:
+            break;
+    }
+
+    free(asset->data);
+    bs_freeAssetEntry(asset);
+}
+
+int bs_getAssetRefCount(void *data) {
+    pthread_mutex_lock(&asset_mutex);
+    bs_Asset *asset = bs_findAssetData(data);
+    int ref_count = asset == NULL ? 0 : asset->ref_count;
+    pthread_mutex_unlock(&asset_mutex);
+
+    return ref_count;
+}
+
+int bs_getAssetCount() {
+    return asset_count;
+}
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <bs_debug.h>
 #include <bs_core.h>
 #include <bs_math.h>
+#include <bs_residency.h>
+#include <bs_uploads.h>
 
 // STD
 #include <string.h>
@@ -309,6 +311,7 @@ void bs_pushTexRect(bs_vec3 pos, bs_vec2 dim, bs_RGBA col, bs_Tex2D *tex) {
         curr_batch->vertex_draw_count+1, curr_batch->vertex_draw_count+2, curr_batch->vertex_draw_count+3,
     };
     memcpy(&curr_batch->indices[curr_batch->index_draw_count], indices, 6 * sizeof(int));
+    bs_markTextureUsed(tex);
 
     bs_pushVertex(pos.x    , pos.y    , pos.z, tex->tex_x , tex->tex_hy, 0.0, 0.0, 0.0, col); // Bottom Left
     bs_pushVertex(dim_pos.x, pos.y    , pos.z, tex->tex_wx, tex->tex_hy, 0.0, 0.0, 0.0, col); // Bottom right
@@ -354,7 +357,10 @@ void bs_pushLine(bs_vec3 start, bs_vec3 end, bs_RGBA color) {
     bs_pushTriangle(start, end, end, color);
 }
 
-void bs_pushPrim(bs_Prim *prim, mat4 model, bs_Mesh *mesh) {
+void bs_pushPrim(bs_Prim *prim, bs_Mesh *mesh) {
+    if(prim->material.tex != NULL)
+        bs_markTextureUsed(prim->material.tex);
+
     for(int i = 0; i < prim->index_count; i++) {
         curr_batch->indices[curr_batch->index_draw_count+i] = prim->indices[i] + curr_batch->vertex_draw_count;
     }
@@ -373,9 +379,10 @@ void bs_pushPrim(bs_Prim *prim, mat4 model, bs_Mesh *mesh) {
         vertex.tex_coord = (bs_vec2){ white_tex_coord, white_tex_coord };
 
         if(prim->material.tex != NULL) {
-            // TODO: These values are constant, unnecessary to set them every frame
-            vertex.tex_coord.x = prim->vertices[i].tex_coord.x + prim->material.tex->tex_x;
-            vertex.tex_coord.y = prim->vertices[i].tex_coord.y + prim->material.tex->tex_y;
+            // Map the texture relative coordinates into the textures rect in the atlas
+            bs_Tex2D *tex = prim->material.tex;
+            vertex.tex_coord.x = tex->tex_x + prim->vertices[i].tex_coord.x * (tex->tex_wx - tex->tex_x);
+            vertex.tex_coord.y = tex->tex_y + prim->vertices[i].tex_coord.y * (tex->tex_hy - tex->tex_y);
         }
 
         bs_pushVertexStruct(&vertex);
@@ -384,20 +391,11 @@ void bs_pushPrim(bs_Prim *prim, mat4 model, bs_Mesh *mesh) {
     curr_batch->index_draw_count += prim->index_count;
 }
 
+// Static meshes are already in model space, the loader baked their node transforms
 void bs_pushMesh(bs_Mesh *mesh) {
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
-
-    vec3 glm_pos = { mesh->pos.x, mesh->pos.y, mesh->pos.z };
-    vec3 glm_sca = { mesh->sca.x, mesh->sca.y, mesh->sca.z };
-    versor glm_rot = { mesh->rot.x, mesh->rot.y, mesh->rot.z, mesh->rot.w }; 
-
-    glm_translate(model, glm_pos);
-    glm_quat_rotate(model, glm_rot, model);
-    glm_scale(model, glm_sca);
-
     for(int i = 0; i < mesh->prim_count; i++) {
         bs_Prim *prim = &mesh->prims[i];
-        bs_pushPrim(prim, model, mesh);
+        bs_pushPrim(prim, mesh);
     }
 }
 
@@ -639,6 +637,8 @@ void bs_render() {
             previousTime = currentTime;
         }
 
+        bs_processUploads();
+
         glClearColor(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -652,6 +652,7 @@ void bs_render() {
         }
 
         bs_checkGLError();
+        bs_updateResidency();
 
         glfwPollEvents();
         glfwSwapBuffers(window);
@@ -672,6 +673,9 @@ void bs_init(int width, int height, char *title, bs_WNDSettings settings) {
     empty_texture.tex_x = empty_texture.tex_y = 0;
     empty_texture.tex_wx = empty_texture.tex_hy = 0;
     empty_texture.data = NULL;
+    empty_texture.data_stride = 0;
+    empty_texture.atlas_id = 0;
+    empty_texture.last_used = 0;
     bs_selectTexture(&empty_texture);
 
     // Allocate 4 framebuffers by default, this auto-increments
@@ -701,6 +705,7 @@ void bs_init(int width, int height, char *title, bs_WNDSettings settings) {
 
 void bs_startRender(void (*render)()) {
     bs_pushAtlas(std_atlas);
+    bs_flushUploads();
     // bs_saveAtlasToFile(std_atlas, "test1.png");
     bs_freeAtlasData(std_atlas);
 
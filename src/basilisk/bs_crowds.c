@@ -0,0 +1,542 @@
+// GL
+#include <glad/glad.h>
+#include <cglm/cglm.h>
+
+// Basilisk
+#include <bs_crowds.h>
+#include <bs_core.h>
+#include <bs_models.h>
+#include <bs_shaders.h>
+#include <bs_residency.h>
+#include <bs_pose.h>
+#include <bs_math.h>
+#include <bs_morphs.h>
+
+// STD
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+// Copies the skinned prims of the model into one buffer, the same way bs_pushPrim fills a rig batch
+// Bone ids are offset by the joints of the previous meshes so they index the whole instance pose
+int bs_fillCrowdVertices(bs_Model *model, bs_RVertex *vertices, int *indices) {
+    int vertex_count = 0, index_count = 0;
+    int joint_base = 0;
+
+    for(int i = 0; i < model->mesh_count; i++) {
+        bs_Mesh *mesh = &model->meshes[i];
+        if(mesh->joint_count == 0)
+            continue;
+
+        for(int j = 0; j < mesh->prim_count; j++) {
+            bs_Prim *prim = &mesh->prims[j];
+
+            for(int k = 0; k < prim->index_count; k++) {
+                indices[index_count++] = prim->indices[k] + vertex_count;
+            }
+
+            for(int k = 0; k < prim->vertex_count; k++) {
+                bs_RVertex vertex = prim->vertices[k];
+                vertex.color = prim->material.base_color;
+                vertex.bone_ids.x += joint_base;
+                vertex.bone_ids.y += joint_base;
+                vertex.bone_ids.z += joint_base;
+                vertex.bone_ids.w += joint_base;
+
+                // Same white texel as bs_pushPrim for untextured prims
+                const float white_tex_coord = 0.9999;
+                vertex.tex_coord = (bs_vec2){ white_tex_coord, white_tex_coord };
+
+                if(prim->material.tex != NULL) {
+                    bs_Tex2D *tex = prim->material.tex;
+                    vertex.tex_coord.x = tex->tex_x + prim->vertices[k].tex_coord.x * (tex->tex_wx - tex->tex_x);
+                    vertex.tex_coord.y = tex->tex_y + prim->vertices[k].tex_coord.y * (tex->tex_hy - tex->tex_y);
+                }
+
+                vertices[vertex_count++] = vertex;
+            }
+        }
+
+        joint_base += mesh->joint_count;
+    }
+
+    return index_count;
+}
+
+void bs_getCrowdSize(bs_Model *model, int *vertex_count, int *index_count) {
+    *vertex_count = *index_count = 0;
+
+    for(int i = 0; i < model->mesh_count; i++) {
+        if(model->meshes[i].joint_count == 0)
+            continue;
+
+        *vertex_count += model->meshes[i].vertex_count;
+        for(int j = 0; j < model->meshes[i].prim_count; j++) {
+            *index_count += model->meshes[i].prims[j].index_count;
+        }
+    }
+}
+
+// Static rig layout at attribute locations 0-5, the VAO stays bound for the instance attributes
+// The buffers stay empty if the model textures aren't packed yet, the UVs would all land on one texel
+int bs_createCrowdGeometry(bs_Model *model, unsigned int *VAO, unsigned int *VBO, unsigned int *EBO) {
+    int vertex_count = 0, index_count = 0;
+    bs_RVertex *vertices = NULL;
+    int *indices = NULL;
+
+    if(bs_areModelTexturesPacked(model)) {
+        bs_getCrowdSize(model, &vertex_count, &index_count);
+        vertices = malloc(vertex_count * sizeof(bs_RVertex));
+        indices = malloc(index_count * sizeof(int));
+        bs_fillCrowdVertices(model, vertices, indices);
+    } else {
+        printf("Crowd geometry has to be created after the atlas is pushed\n");
+    }
+
+    glGenVertexArrays(1, VAO);
+    glGenBuffers(1, VBO);
+    glGenBuffers(1, EBO);
+
+    glBindVertexArray(*VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_count * sizeof(bs_RVertex), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(int), indices, GL_STATIC_DRAW);
+
+    // Rig batch layout
+    for(int i = 0; i < 6; i++) {
+        glEnableVertexAttribArray(i);
+    }
+
+    glVertexAttribPointer (0, 3, BS_FLOAT, false, sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, position));
+    glVertexAttribPointer (1, 2, BS_FLOAT, false, sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, tex_coord));
+    glVertexAttribPointer (2, 3, BS_FLOAT, false, sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, normal));
+    glVertexAttribPointer (3, 4, BS_UBYTE, true , sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, color));
+    glVertexAttribIPointer(4, 4, GL_INT  ,        sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, bone_ids));
+    glVertexAttribPointer (5, 4, BS_FLOAT, false, sizeof(bs_RVertex), (void*)offsetof(bs_RVertex, weights));
+
+    free(vertices);
+    free(indices);
+
+    return index_count;
+}
+
+void bs_markCrowdTexturesUsed(bs_Model *model) {
+    for(int i = 0; i < model->mesh_count; i++) {
+        bs_Mesh *mesh = &model->meshes[i];
+
+        for(int j = 0; j < mesh->prim_count && mesh->joint_count > 0; j++) {
+            if(mesh->prims[j].material.tex != NULL)
+                bs_markTextureUsed(mesh->prims[j].material.tex);
+        }
+    }
+}
+
+void bs_createCrowd(bs_Crowd *crowd, bs_Model *model, bs_Shader *shader) {
+    crowd->model = model;
+    crowd->shader = shader;
+    crowd->offsets = NULL;
+    crowd->instance_count = 0;
+    crowd->instance_capacity = 0;
+
+    crowd->index_count = bs_createCrowdGeometry(model, &crowd->VAO, &crowd->VBO, &crowd->EBO);
+
+    // Palette offsets advance once per instance
+    glGenBuffers(1, &crowd->instance_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, crowd->instance_VBO);
+    glEnableVertexAttribArray(6);
+    glVertexAttribIPointer(6, 1, GL_INT, sizeof(int), (void*)0);
+    glVertexAttribDivisor(6, 1);
+
+    glBindVertexArray(0);
+    bs_createPaletteBuffer(&crowd->palettes);
+}
+
+void bs_freeCrowd(bs_Crowd *crowd) {
+    glDeleteVertexArrays(1, &crowd->VAO);
+    glDeleteBuffers(1, &crowd->VBO);
+    glDeleteBuffers(1, &crowd->EBO);
+    glDeleteBuffers(1, &crowd->instance_VBO);
+
+    bs_freePaletteBuffer(&crowd->palettes);
+    free(crowd->offsets);
+    crowd->offsets = NULL;
+    crowd->instance_count = crowd->instance_capacity = 0;
+}
+
+// Called at the start of every frame before the instances are pushed again
+void bs_clearCrowd(bs_Crowd *crowd) {
+    crowd->instance_count = 0;
+    bs_clearPalettes(&crowd->palettes);
+}
+
+// The instance transform is folded into its palette so the offset is all the vertex shader needs
+int bs_pushInstancePalette(bs_PaletteBuffer *palettes, bs_ModelInstance *instance) {
+    int offset = bs_pushPalette(palettes, instance->pose, instance->pose_count);
+
+    bs_mat4 matrix;
+    bs_getInstanceMatrix(instance, matrix);
+    for(int i = 0; i < instance->pose_count; i++) {
+        glm_mul(matrix, palettes->data[offset + i], palettes->data[offset + i]);
+    }
+
+    return offset;
+}
+
+// The instance has to be posed already (bs_animateInstances)
+void bs_pushCrowdInstance(bs_Crowd *crowd, bs_ModelInstance *instance) {
+    if(crowd->instance_count == crowd->instance_capacity) {
+        crowd->instance_capacity = crowd->instance_capacity == 0 ? 64 : crowd->instance_capacity * 2;
+        crowd->offsets = realloc(crowd->offsets, crowd->instance_capacity * sizeof(int));
+    }
+
+    crowd->offsets[crowd->instance_count++] = bs_pushInstancePalette(&crowd->palettes, instance);
+}
+
+void bs_renderCrowd(bs_Crowd *crowd, bs_Camera *camera) {
+    if(crowd->instance_count == 0 || crowd->index_count == 0)
+        return;
+
+    bs_markCrowdTexturesUsed(crowd->model);
+    bs_uploadPalettes(&crowd->palettes);
+
+    glBindBuffer(GL_ARRAY_BUFFER, crowd->instance_VBO);
+    glBufferData(GL_ARRAY_BUFFER, crowd->instance_count * sizeof(int), crowd->offsets, GL_STREAM_DRAW);
+
+    bs_setViewMatrixUniform(crowd->shader, camera);
+    bs_setProjMatrixUniform(crowd->shader, camera);
+    bs_setPaletteUniform(crowd->shader, &crowd->palettes, BS_CROWD_PALETTE_UNIT);
+
+    glBindVertexArray(crowd->VAO);
+    glDrawElementsInstanced(BS_TRIANGLES, crowd->index_count, GL_UNSIGNED_INT, 0, crowd->instance_count);
+    glBindVertexArray(0);
+}
+
+/* --- TRANSFORM FEEDBACK SKINNING --- */
+const char *skin_varyings[] = { "bs_OutPosition", "bs_OutTexCoord", "bs_OutNormal", "bs_OutColor" };
+
+void bs_loadSkinShader(char *vs_path, bs_Shader *shader) {
+    bs_loadFeedbackShader(vs_path, skin_varyings, sizeof(skin_varyings) / sizeof(skin_varyings[0]), shader);
+}
+
+void bs_createSkinPass(bs_SkinPass *pass, bs_Model *model, bs_Shader *shader) {
+    pass->model = model;
+    pass->shader = shader;
+
+    int index_count;
+    bs_getCrowdSize(model, &pass->vertex_count, &index_count);
+
+    // Source vertices are read as points, the index buffer is only used by the output
+    pass->index_count = bs_createCrowdGeometry(model, &pass->src_VAO, &pass->src_VBO, &pass->EBO);
+    if(pass->index_count == 0)
+        pass->vertex_count = 0;
+    glBindVertexArray(0);
+
+    // The captured varyings match bs_Vertex byte for byte
+    glGenVertexArrays(1, &pass->VAO);
+    glGenBuffers(1, &pass->VBO);
+
+    glBindVertexArray(pass->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, pass->VBO);
+    glBufferData(GL_ARRAY_BUFFER, pass->vertex_count * sizeof(bs_Vertex), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pass->EBO);
+
+    for(int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(i);
+    }
+
+    glVertexAttribPointer(0, 3, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, position));
+    glVertexAttribPointer(1, 2, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, tex_coord));
+    glVertexAttribPointer(2, 3, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, normal));
+    glVertexAttribPointer(3, 4, BS_UBYTE, true , sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, color));
+
+    glBindVertexArray(0);
+    bs_createPaletteBuffer(&pass->palettes);
+    bs_createMorphBuffer(&pass->morphs, model);
+}
+
+void bs_freeSkinPass(bs_SkinPass *pass) {
+    glDeleteVertexArrays(1, &pass->src_VAO);
+    glDeleteBuffers(1, &pass->src_VBO);
+    glDeleteVertexArrays(1, &pass->VAO);
+    glDeleteBuffers(1, &pass->VBO);
+    glDeleteBuffers(1, &pass->EBO);
+
+    bs_freePaletteBuffer(&pass->palettes);
+    bs_freeMorphBuffer(&pass->morphs);
+}
+
+// Skins every vertex once into the output buffer, nothing is rasterized
+// The instance has to be posed already (bs_animateInstances)
+void bs_runSkinPass(bs_SkinPass *pass, bs_ModelInstance *instance) {
+    if(pass->vertex_count == 0)
+        return;
+
+    bs_clearPalettes(&pass->palettes);
+    int offset = bs_pushInstancePalette(&pass->palettes, instance);
+    bs_uploadPalettes(&pass->palettes);
+
+    bs_switchShader(pass->shader);
+    bs_setPaletteUniform(pass->shader, &pass->palettes, BS_CROWD_PALETTE_UNIT);
+    bs_setJointOffsetUniform(pass->shader, offset);
+
+    if(pass->morphs.delta_count > 0) {
+        bs_uploadMorphWeights(&pass->morphs, instance->weights);
+        bs_setMorphUniforms(pass->shader, &pass->morphs);
+    }
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(pass->src_VAO);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, pass->VBO);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, pass->vertex_count);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// Any number of passes can draw the skinned result, each with its own shader and camera
+void bs_renderSkinPass(bs_SkinPass *pass, bs_Shader *shader, bs_Camera *camera) {
+    if(pass->index_count == 0)
+        return;
+
+    bs_markCrowdTexturesUsed(pass->model);
+
+    bs_setViewMatrixUniform(shader, camera);
+    bs_setProjMatrixUniform(shader, camera);
+
+    glBindVertexArray(pass->VAO);
+    glDrawElements(BS_TRIANGLES, pass->index_count, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+/* --- VERTEX ANIMATION TEXTURES --- */
+void bs_skinVertex(bs_RVertex *vertex, bs_mat4 *pose, float *position, float *normal) {
+    int *ids = (int *)&vertex->bone_ids;
+    float *weights = (float *)&vertex->weights;
+    vec4 rest_position = { vertex->position.x, vertex->position.y, vertex->position.z, 1.0 };
+    vec3 rest_normal = { vertex->normal.x, vertex->normal.y, vertex->normal.z };
+
+    vec4 skinned_position = GLM_VEC4_ZERO_INIT;
+    vec3 skinned_normal = GLM_VEC3_ZERO_INIT;
+    float total_weight = 0.0;
+
+    for(int i = 0; i < 4; i++) {
+        if(weights[i] == 0.0)
+            continue;
+
+        vec4 p;
+        vec3 n;
+        glm_mat4_mulv(pose[ids[i]], rest_position, p);
+        glm_mat4_mulv3(pose[ids[i]], rest_normal, 0.0, n);
+
+        glm_vec4_muladds(p, weights[i], skinned_position);
+        glm_vec3_muladds(n, weights[i], skinned_normal);
+        total_weight += weights[i];
+    }
+
+    // Vertices without weights stay where they are
+    if(total_weight == 0.0) {
+        glm_vec4_copy(rest_position, skinned_position);
+        glm_vec3_copy(rest_normal, skinned_normal);
+    }
+
+    glm_vec3_normalize(skinned_normal);
+    memcpy(position, skinned_position, 3 * sizeof(float));
+    memcpy(normal, skinned_normal, 3 * sizeof(float));
+}
+
+// Crowd vertices follow the prims of the skinned meshes, weights cover every mesh
+void bs_morphCrowdVertices(bs_Model *model, float *weights, bs_RVertex *vertices) {
+    for(int i = 0; i < model->mesh_count; i++) {
+        bs_Mesh *mesh = &model->meshes[i];
+
+        for(int j = 0; mesh->joint_count > 0 && j < mesh->prim_count; j++) {
+            if(mesh->target_count > 0)
+                bs_morphPrim(&mesh->prims[j], weights, mesh->target_count, vertices);
+
+            vertices += mesh->prims[j].vertex_count;
+        }
+
+        weights += mesh->target_count;
+    }
+}
+
+// Skins the crowd vertices on the CPU for every frame of the clip, returns RGBA floats of
+// vertex_count * frame_count positions followed by as many normals
+float *bs_bakeVertexAnim(bs_Model *model, bs_Anim *anim, float fps, int *vertex_count, int *frame_count) {
+    int index_count;
+    bs_getCrowdSize(model, vertex_count, &index_count);
+
+    bs_RVertex *vertices = malloc(*vertex_count * sizeof(bs_RVertex));
+    int *indices = malloc(index_count * sizeof(int));
+    bs_fillCrowdVertices(model, vertices, indices);
+    free(indices);
+
+    // Frames are spread evenly and the last lands on the end of the clip so looping clips wrap without a seam
+    *frame_count = BS_MAX((int)ceilf(anim->duration * fps), 1) + 1;
+    int row = *vertex_count * 4;
+    float *texels = calloc(1, 2 * *frame_count * row * sizeof(float));
+
+    bs_ModelInstance instance;
+    bs_createModelInstance(&instance, model);
+    instance.anim = anim;
+
+    // Morph targets are blended on the CPU into a copy of the vertices before skinning
+    bs_RVertex *morphed = instance.weight_count > 0 ? malloc(*vertex_count * sizeof(bs_RVertex)) : vertices;
+
+    for(int f = 0; f < *frame_count; f++) {
+        instance.time = f * anim->duration / (*frame_count - 1);
+        bs_animateInstance(&instance);
+
+        if(morphed != vertices) {
+            memcpy(morphed, vertices, *vertex_count * sizeof(bs_RVertex));
+            bs_morphCrowdVertices(model, instance.weights, morphed);
+        }
+
+        for(int v = 0; v < *vertex_count; v++) {
+            float *position = texels + f * row + v * 4;
+            float *normal = texels + (*frame_count + f) * row + v * 4;
+            bs_skinVertex(&morphed[v], instance.pose, position, normal);
+        }
+    }
+
+    if(morphed != vertices)
+        free(morphed);
+
+    bs_freeModelInstance(&instance);
+    free(vertices);
+
+    return texels;
+}
+
+void bs_createVertexAnim(bs_VertexAnim *vertex_anim, bs_Model *model, bs_Anim *anim, float fps, bs_Shader *shader) {
+    vertex_anim->model = model;
+    vertex_anim->shader = shader;
+    vertex_anim->duration = anim->duration;
+    vertex_anim->instances = NULL;
+    vertex_anim->instance_count = 0;
+    vertex_anim->instance_capacity = 0;
+
+    float *texels = bs_bakeVertexAnim(model, anim, fps, &vertex_anim->vertex_count, &vertex_anim->frame_count);
+
+    GLint max_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+    int vertex_count = vertex_anim->vertex_count;
+    int blocks = 2 * vertex_anim->frame_count;
+    vertex_anim->width = BS_MAX(BS_MIN(vertex_count, max_size), 1);
+    vertex_anim->rows = BS_MAX((vertex_count + vertex_anim->width - 1) / vertex_anim->width, 1);
+
+    bool fits = (int64_t)blocks * vertex_anim->rows <= max_size;
+    if(!fits)
+        printf("Vertex animation doesn't fit a texture: %d vertices, %d frames\n", vertex_count, vertex_anim->frame_count);
+
+    // Every frame starts on a new row, the rest of its last row is padding
+    float *wrapped = texels;
+    if(fits && vertex_anim->rows > 1) {
+        size_t block_size = (size_t)vertex_anim->rows * vertex_anim->width * 4;
+        wrapped = calloc(blocks * block_size, sizeof(float));
+
+        for(int i = 0; i < blocks; i++) {
+            memcpy(wrapped + i * block_size, texels + (size_t)i * vertex_count * 4, vertex_count * 4 * sizeof(float));
+        }
+    }
+
+    // Frames are blended in the shader, nearest filtering keeps neighbouring vertices apart
+    // Created on the animation unit, the active one can hold an atlas
+    GLint prev_unit;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &prev_unit);
+    glActiveTexture(GL_TEXTURE0 + BS_VERTEX_ANIM_UNIT);
+
+    glGenTextures(1, &vertex_anim->texture);
+    glBindTexture(GL_TEXTURE_2D, vertex_anim->texture);
+    if(fits)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, vertex_anim->width, blocks * vertex_anim->rows, 0, GL_RGBA, GL_FLOAT, wrapped);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(prev_unit);
+
+    if(wrapped != texels)
+        free(wrapped);
+    free(texels);
+
+    vertex_anim->index_count = bs_createCrowdGeometry(model, &vertex_anim->VAO, &vertex_anim->VBO, &vertex_anim->EBO);
+    if(!fits)
+        vertex_anim->index_count = 0;
+
+    glGenBuffers(1, &vertex_anim->instance_VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_anim->instance_VBO);
+
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 1, BS_FLOAT, false, sizeof(bs_VertexAnimInstance), (void*)offsetof(bs_VertexAnimInstance, time));
+    glVertexAttribDivisor(6, 1);
+
+    // A mat4 attribute takes one location per column
+    for(int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(7 + i);
+        glVertexAttribPointer(7 + i, 4, BS_FLOAT, false, sizeof(bs_VertexAnimInstance), (void*)(offsetof(bs_VertexAnimInstance, matrix) + i * sizeof(vec4)));
+        glVertexAttribDivisor(7 + i, 1);
+    }
+
+    glBindVertexArray(0);
+}
+
+void bs_freeVertexAnim(bs_VertexAnim *vertex_anim) {
+    glDeleteTextures(1, &vertex_anim->texture);
+    glDeleteVertexArrays(1, &vertex_anim->VAO);
+    glDeleteBuffers(1, &vertex_anim->VBO);
+    glDeleteBuffers(1, &vertex_anim->EBO);
+    glDeleteBuffers(1, &vertex_anim->instance_VBO);
+
+    free(vertex_anim->instances);
+    vertex_anim->instances = NULL;
+    vertex_anim->instance_count = vertex_anim->instance_capacity = 0;
+}
+
+void bs_clearVertexAnim(bs_VertexAnim *vertex_anim) {
+    vertex_anim->instance_count = 0;
+}
+
+void bs_pushVertexAnimInstance(bs_VertexAnim *vertex_anim, bs_mat4 matrix, float time) {
+    if(vertex_anim->instance_count == vertex_anim->instance_capacity) {
+        vertex_anim->instance_capacity = vertex_anim->instance_capacity == 0 ? 64 : vertex_anim->instance_capacity * 2;
+        vertex_anim->instances = realloc(vertex_anim->instances, vertex_anim->instance_capacity * sizeof(bs_VertexAnimInstance));
+    }
+
+    bs_VertexAnimInstance *instance = &vertex_anim->instances[vertex_anim->instance_count++];
+    glm_mat4_copy(matrix, instance->matrix);
+    instance->time = time;
+}
+
+void bs_renderVertexAnim(bs_VertexAnim *vertex_anim, bs_Camera *camera) {
+    if(vertex_anim->instance_count == 0 || vertex_anim->index_count == 0)
+        return;
+
+    bs_markCrowdTexturesUsed(vertex_anim->model);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_anim->instance_VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_anim->instance_count * sizeof(bs_VertexAnimInstance), vertex_anim->instances, GL_STREAM_DRAW);
+
+    bs_Shader *shader = vertex_anim->shader;
+    bs_setViewMatrixUniform(shader, camera);
+    bs_setProjMatrixUniform(shader, camera);
+
+    glActiveTexture(GL_TEXTURE0 + BS_VERTEX_ANIM_UNIT);
+    glBindTexture(GL_TEXTURE_2D, vertex_anim->texture);
+    glActiveTexture(GL_TEXTURE0);
+    bs_uniform_int(bs_getUniformLoc(shader, "bs_VertexAnim"), BS_VERTEX_ANIM_UNIT);
+    bs_uniform_int(bs_getUniformLoc(shader, "bs_VertexAnimFrames"), vertex_anim->frame_count);
+    bs_uniform_int(bs_getUniformLoc(shader, "bs_VertexAnimWidth"), vertex_anim->width);
+    bs_uniform_int(bs_getUniformLoc(shader, "bs_VertexAnimRows"), vertex_anim->rows);
+    bs_uniform_float(bs_getUniformLoc(shader, "bs_VertexAnimDuration"), vertex_anim->duration);
+
+    glBindVertexArray(vertex_anim->VAO);
+    glDrawElementsInstanced(BS_TRIANGLES, vertex_anim->index_count, GL_UNSIGNED_INT, 0, vertex_anim->instance_count);
+    glBindVertexArray(0);
+}
\ No newline at end of file
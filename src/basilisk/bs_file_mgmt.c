@@ -2,6 +2,15 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 char* bs_readFileToString(char *path, int *errcode) {
     if(path == 0) {
@@ -40,4 +49,71 @@ void bs_appendToFile(const char *filepath, const char *data) {
         fputs(data, fp);
         fclose(fp);
     }
+}
+
+// Maps a whole file copy-on-write, writes stay private to the process and never reach the file
+void *bs_mapFile(char *path, size_t *size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if(mapping == NULL)
+        return NULL;
+
+    // The view keeps the mapping alive
+    void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if(data == NULL)
+        return NULL;
+
+    *size = file_size.QuadPart;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd == -1)
+        return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return NULL;
+
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+void bs_unmapFile(void *data, size_t size) {
+    if(data == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// Last modification time, -1 if the file doesn't exist
+long long bs_getFileTime(char *path) {
+    struct stat st;
+    if(stat(path, &st) != 0)
+        return -1;
+
+    return st.st_mtime;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+// Basilisk
+#include <bs_jobs.h>
+
+// STD
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#define BS_MAX_WORKERS 32
+
+typedef struct {
+    void (*fn)(int index, void *arg);
+    void *arg;
+    int count;
+    int generation;
+
+    // Workers currently running this job, guarded by job_mutex
+    int active;
+    atomic_int next;
+} bs_Job;
+
+pthread_t workers[BS_MAX_WORKERS];
+int worker_count = 0;
+
+pthread_once_t jobs_once = PTHREAD_ONCE_INIT;
+pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t submit_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+bs_Job *curr_job = NULL;
+int job_generation = 0;
+_Thread_local bool in_job = false;
+
+void bs_runJob(bs_Job *job) {
+    in_job = true;
+
+    for(;;) {
+        int i = atomic_fetch_add(&job->next, 1);
+        if(i >= job->count)
+            break;
+
+        job->fn(i, job->arg);
+    }
+
+    in_job = false;
+}
+
+void *bs_workerLoop(void *unused) {
+    int seen = 0;
+
+    pthread_mutex_lock(&job_mutex);
+    for(;;) {
+        while(curr_job == NULL || curr_job->generation == seen) {
+            pthread_cond_wait(&job_cond, &job_mutex);
+        }
+
+        bs_Job *job = curr_job;
+        seen = job->generation;
+        job->active++;
+        pthread_mutex_unlock(&job_mutex);
+
+        bs_runJob(job);
+
+        pthread_mutex_lock(&job_mutex);
+        if(--job->active == 0)
+            pthread_cond_broadcast(&done_cond);
+    }
+
+    return NULL;
+}
+
+int bs_getCPUCount() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+void bs_initWorkers() {
+    // The calling thread counts as one worker
+    int count = bs_getCPUCount() - 1;
+    if(count > BS_MAX_WORKERS)
+        count = BS_MAX_WORKERS;
+
+    for(int i = 0; i < count; i++) {
+        if(pthread_create(&workers[i], NULL, bs_workerLoop, NULL) != 0)
+            break;
+
+        pthread_detach(workers[i]);
+        worker_count++;
+    }
+}
+
+int bs_getWorkerCount() {
+    pthread_once(&jobs_once, bs_initWorkers);
+    return worker_count + 1;
+}
+
+void bs_parallelFor(int count, void (*fn)(int index, void *arg), void *arg) {
+    // Not worth waking the workers, or we're already on one of them
+    if(count <= 1 || in_job || bs_getWorkerCount() == 1) {
+        for(int i = 0; i < count; i++) {
+            fn(i, arg);
+        }
+        return;
+    }
+
+    bs_Job job;
+    job.fn = fn;
+    job.arg = arg;
+    job.count = count;
+    job.active = 0;
+    atomic_init(&job.next, 0);
+
+    pthread_mutex_lock(&submit_mutex);
+
+    pthread_mutex_lock(&job_mutex);
+    job.generation = ++job_generation;
+    curr_job = &job;
+    pthread_cond_broadcast(&job_cond);
+    pthread_mutex_unlock(&job_mutex);
+
+    bs_runJob(&job);
+
+    // All indices are claimed, wait for the workers still finishing theirs
+    pthread_mutex_lock(&job_mutex);
+    while(job.active > 0) {
+        pthread_cond_wait(&done_cond, &job_mutex);
+    }
+    curr_job = NULL;
+    pthread_mutex_unlock(&job_mutex);
+
+    pthread_mutex_unlock(&submit_mutex);
+}
\ No newline at end of file
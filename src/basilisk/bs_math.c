@@ -1,3 +1,7 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
 int bs_sign(float x) {
 	return (x > 0) - (x < 0);
 }
@@ -5,4 +9,75 @@ int bs_sign(float x) {
 double bs_fMap(double input, double input_start, double input_end, double output_start, double output_end) {
 	double slope = 1.0 * (output_end - output_start) / (input_end - input_start);
 	return output_start + slope * (input - input_start);
+}
+
+// Fast non-cryptographic hash, consumes 8 bytes per step
+uint64_t bs_hash64(const void *data, size_t len, uint64_t seed) {
+	const unsigned char *bytes = data;
+	uint64_t h = seed ^ (len * 0x9E3779B97F4A7C15ull);
+
+	size_t i = 0;
+	for(; i + 8 <= len; i += 8) {
+		uint64_t w;
+		memcpy(&w, bytes + i, 8);
+
+		w *= 0x87C37B91114253D5ull;
+		w  = (w << 31) | (w >> 33);
+		h ^= w * 0x4CF5AD432745937Full;
+		h  = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, bytes + i, len - i);
+	h ^= tail * 0x87C37B91114253D5ull;
+
+	// Final avalanche
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+
+	return h;
+}
+
+// IEEE half floats, values too small for a normal half flush to zero
+uint16_t bs_floatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if(exponent <= 0)
+		return sign;
+
+	if(exponent >= 31)
+		return sign | 0x7C00;
+
+	// Rounds to nearest, a carry out of the mantissa bumps the exponent as it should
+	uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+	if(mantissa & 0x1000)
+		half++;
+
+	return half;
+}
+
+float bs_halfToFloat(uint16_t half) {
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	int exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+	uint32_t bits;
+
+	if(exponent == 0)
+		bits = sign;
+	else if(exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
 }
\ No newline at end of file
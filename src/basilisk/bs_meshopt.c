@@ -0,0 +1,372 @@
+#include <string.h>
+#include <math.h>
+
+#include <bs_meshopt.h>
+#include <bs_math.h>
+
+// Vertex blocks are decoded through a buffer of this size, bytes are grouped by 16
+#define BS_VERTEX_BLOCK_BYTES 8192
+#define BS_VERTEX_BLOCK_MAX 256
+#define BS_BYTE_GROUP_SIZE 16
+// Longest a byte group can be, the stream tail guarantees this much can be read
+#define BS_BYTE_GROUP_LIMIT 24
+// The first vertex is stored at the end of the stream, padded to at least this
+#define BS_VERTEX_TAIL_MIN 32
+
+/* --- VERTEX CODEC --- */
+// 16 values of 0, 2, 4 or 8 bits, the largest 2 and 4 bit values mean the byte follows the packed bits
+const uint8_t *bs_decodeBytesGroup(const uint8_t *data, uint8_t *buffer, int bits_log2) {
+	if(bits_log2 == 0) {
+		memset(buffer, 0, BS_BYTE_GROUP_SIZE);
+		return data;
+	}
+
+	if(bits_log2 == 3) {
+		memcpy(buffer, data, BS_BYTE_GROUP_SIZE);
+		return data + BS_BYTE_GROUP_SIZE;
+	}
+
+	int bits = bits_log2 == 1 ? 2 : 4;
+	int sentinel = (1 << bits) - 1;
+	int packed_size = BS_BYTE_GROUP_SIZE * bits / 8;
+	const uint8_t *extra = data + packed_size;
+
+	// Highest bits first
+	for(int i = 0; i < BS_BYTE_GROUP_SIZE; i++) {
+		int shift = 8 - bits - (i * bits) % 8;
+		int value = (data[i * bits / 8] >> shift) & sentinel;
+
+		buffer[i] = value == sentinel ? *extra++ : value;
+	}
+
+	return extra;
+}
+
+const uint8_t *bs_decodeBytes(const uint8_t *data, const uint8_t *data_end, uint8_t *buffer, size_t buffer_size) {
+	// Two bits of header per group
+	size_t header_size = (buffer_size / BS_BYTE_GROUP_SIZE + 3) / 4;
+	if((size_t)(data_end - data) < header_size)
+		return NULL;
+
+	const uint8_t *header = data;
+	data += header_size;
+
+	for(size_t i = 0; i < buffer_size; i += BS_BYTE_GROUP_SIZE) {
+		if((size_t)(data_end - data) < BS_BYTE_GROUP_LIMIT)
+			return NULL;
+
+		size_t group = i / BS_BYTE_GROUP_SIZE;
+		int bits_log2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+		data = bs_decodeBytesGroup(data, buffer + i, bits_log2);
+	}
+
+	return data;
+}
+
+// Every byte of the vertex is stored on its own as zigzag deltas from the previous vertex
+const uint8_t *bs_decodeVertexBlock(const uint8_t *data, const uint8_t *data_end, uint8_t *dst, size_t count, size_t stride, uint8_t *last_vertex) {
+	uint8_t buffer[BS_VERTEX_BLOCK_MAX];
+	uint8_t transposed[BS_VERTEX_BLOCK_BYTES];
+	size_t count_aligned = (count + BS_BYTE_GROUP_SIZE - 1) & ~(size_t)(BS_BYTE_GROUP_SIZE - 1);
+
+	for(size_t k = 0; k < stride; k++) {
+		data = bs_decodeBytes(data, data_end, buffer, count_aligned);
+		if(data == NULL)
+			return NULL;
+
+		uint8_t previous = last_vertex[k];
+		for(size_t i = 0; i < count; i++) {
+			uint8_t delta = (uint8_t)(-(buffer[i] & 1) ^ (buffer[i] >> 1));
+			previous += delta;
+			transposed[i * stride + k] = previous;
+		}
+	}
+
+	memcpy(dst, transposed, count * stride);
+	memcpy(last_vertex, transposed + (count - 1) * stride, stride);
+
+	return data;
+}
+
+bool bs_decodeVertexBuffer(void *dst, size_t count, size_t stride, const uint8_t *src, size_t size) {
+	if(stride == 0 || stride > BS_VERTEX_BLOCK_MAX || stride % 4 != 0)
+		return false;
+
+	size_t tail_size = BS_MAX(stride, BS_VERTEX_TAIL_MIN);
+	if(size < 1 + tail_size || src[0] != 0xA0)
+		return false;
+
+	const uint8_t *data = src + 1;
+	const uint8_t *data_end = src + size;
+
+	uint8_t last_vertex[BS_VERTEX_BLOCK_MAX];
+	memcpy(last_vertex, data_end - stride, stride);
+
+	size_t block_size = BS_MIN((BS_VERTEX_BLOCK_BYTES / stride) & ~(size_t)(BS_BYTE_GROUP_SIZE - 1), BS_VERTEX_BLOCK_MAX);
+
+	for(size_t offset = 0; offset < count; offset += block_size) {
+		size_t block_count = BS_MIN(block_size, count - offset);
+
+		data = bs_decodeVertexBlock(data, data_end, (uint8_t *)dst + offset * stride, block_count, stride, last_vertex);
+		if(data == NULL)
+			return false;
+	}
+
+	return (size_t)(data_end - data) == tail_size;
+}
+
+/* --- INDEX CODECS --- */
+uint32_t bs_decodeVByte(const uint8_t **data) {
+	const uint8_t *p = *data;
+	uint32_t lead = *p++;
+
+	if(lead < 128) {
+		*data = p;
+		return lead;
+	}
+
+	// Little endian groups of 7 bits, 5 bytes at most
+	uint32_t result = lead & 127;
+	for(int shift = 7; shift <= 28; shift += 7) {
+		uint8_t group = *p++;
+		result |= (uint32_t)(group & 127) << shift;
+
+		if(group < 128)
+			break;
+	}
+
+	*data = p;
+	return result;
+}
+
+// Zigzag delta from the last free index
+uint32_t bs_decodeIndex(const uint8_t **data, uint32_t last) {
+	uint32_t v = bs_decodeVByte(data);
+	return last + ((v >> 1) ^ -(v & 1));
+}
+
+void bs_writeTriangle(void *dst, size_t offset, size_t index_size, uint32_t a, uint32_t b, uint32_t c) {
+	if(index_size == 2) {
+		uint16_t *indices = (uint16_t *)dst + offset;
+		indices[0] = a;
+		indices[1] = b;
+		indices[2] = c;
+	} else {
+		uint32_t *indices = (uint32_t *)dst + offset;
+		indices[0] = a;
+		indices[1] = b;
+		indices[2] = c;
+	}
+}
+
+// Triangles are rebuilt from a 16 entry fifo of recent edges and one of recent vertices,
+// the decoder has to push into them exactly like the encoder did
+typedef struct {
+	uint32_t edges[16][2];
+	uint32_t vertices[16];
+	size_t edge_offset;
+	size_t vertex_offset;
+} bs_IndexFifo;
+
+void bs_pushEdge(bs_IndexFifo *fifo, uint32_t a, uint32_t b) {
+	fifo->edges[fifo->edge_offset][0] = a;
+	fifo->edges[fifo->edge_offset][1] = b;
+	fifo->edge_offset = (fifo->edge_offset + 1) & 15;
+}
+
+void bs_pushVertex(bs_IndexFifo *fifo, uint32_t v, bool push) {
+	fifo->vertices[fifo->vertex_offset] = v;
+	fifo->vertex_offset = (fifo->vertex_offset + push) & 15;
+}
+
+bool bs_decodeIndexBuffer(void *dst, size_t count, size_t index_size, const uint8_t *src, size_t size) {
+	if(count % 3 != 0 || (index_size != 2 && index_size != 4))
+		return false;
+
+	// Header, a code byte per triangle and the 16 byte table of auxiliary codes at the end
+	if(size < 1 + count / 3 + 16 || (src[0] & 0xF0) != 0xE0 || (src[0] & 0x0F) > 1)
+		return false;
+
+	// Version 1 spends fec 13 and 14 on the last free index -1 and +1
+	int version = src[0] & 0x0F;
+	uint32_t fec_max = version >= 1 ? 13 : 15;
+
+	bs_IndexFifo fifo;
+	memset(&fifo, -1, sizeof(fifo));
+	fifo.edge_offset = fifo.vertex_offset = 0;
+
+	uint32_t next = 0, last = 0;
+	const uint8_t *code = src + 1;
+	const uint8_t *data = code + count / 3;
+	const uint8_t *data_safe_end = src + size - 16;
+	const uint8_t *aux_table = data_safe_end;
+
+	for(size_t i = 0; i < count; i += 3) {
+		if(data > data_safe_end)
+			return false;
+
+		uint8_t codetri = *code++;
+
+		// The triangle shares an edge with a recent one
+		if(codetri < 0xF0) {
+			int fe = codetri >> 4;
+			uint32_t a = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][0];
+			uint32_t b = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][1];
+			uint32_t fec = codetri & 15;
+			uint32_t c;
+
+			if(fec < fec_max) {
+				c = fec == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - 1 - fec) & 15];
+				bs_pushVertex(&fifo, c, fec == 0);
+			} else {
+				last = c = fec != 15 ? last + (fec == 13 ? -1 : 1) : bs_decodeIndex(&data, last);
+				bs_pushVertex(&fifo, c, true);
+			}
+
+			bs_writeTriangle(dst, i, index_size, a, b, c);
+			bs_pushEdge(&fifo, c, b);
+			bs_pushEdge(&fifo, a, c);
+			continue;
+		}
+
+		// Three vertices from the vertex fifo, new ones or free indices
+		int fea, feb, fec;
+		if(codetri < 0xFE) {
+			uint8_t aux = aux_table[codetri & 15];
+			fea = 0;
+			feb = aux >> 4;
+			fec = aux & 15;
+		} else {
+			uint8_t aux = *data++;
+			fea = codetri == 0xFE ? 0 : 15;
+			feb = aux >> 4;
+			fec = aux & 15;
+
+			// A zero auxiliary byte outside of the table restarts the new index counter
+			if(aux == 0)
+				next = 0;
+		}
+
+		// New indices are handed out in order before any fifo lookup
+		uint32_t a = fea == 0 ? next++ : 0;
+		uint32_t b = feb == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - feb) & 15];
+		uint32_t c = fec == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - fec) & 15];
+
+		if(fea == 15)
+			last = a = bs_decodeIndex(&data, last);
+		if(feb == 15)
+			last = b = bs_decodeIndex(&data, last);
+		if(fec == 15)
+			last = c = bs_decodeIndex(&data, last);
+
+		bs_writeTriangle(dst, i, index_size, a, b, c);
+		bs_pushVertex(&fifo, a, true);
+		bs_pushVertex(&fifo, b, feb == 0 || feb == 15);
+		bs_pushVertex(&fifo, c, fec == 0 || fec == 15);
+		bs_pushEdge(&fifo, b, a);
+		bs_pushEdge(&fifo, c, b);
+		bs_pushEdge(&fifo, a, c);
+	}
+
+	return data == data_safe_end;
+}
+
+// Zigzag deltas against one of two running baselines, the low bit picks which
+bool bs_decodeIndexSequence(void *dst, size_t count, size_t index_size, const uint8_t *src, size_t size) {
+	if(index_size != 2 && index_size != 4)
+		return false;
+
+	if(size < 1 + count + 4 || (src[0] & 0xF0) != 0xD0 || (src[0] & 0x0F) > 1)
+		return false;
+
+	const uint8_t *data = src + 1;
+	const uint8_t *data_safe_end = src + size - 4;
+	uint32_t last[2] = { 0, 0 };
+
+	for(size_t i = 0; i < count; i++) {
+		if(data >= data_safe_end)
+			return false;
+
+		uint32_t v = bs_decodeVByte(&data);
+		int baseline = v & 1;
+		v >>= 1;
+
+		uint32_t index = last[baseline] + ((v >> 1) ^ -(v & 1));
+		last[baseline] = index;
+
+		if(index_size == 2)
+			((uint16_t *)dst)[i] = index;
+		else
+			((uint32_t *)dst)[i] = index;
+	}
+
+	return data == data_safe_end;
+}
+
+/* --- FILTERS --- */
+int bs_roundSigned(float value) {
+	return (int)(value + (value >= 0.0 ? 0.5 : -0.5));
+}
+
+// Octahedral unit vectors in 8 or 16 bit components, z holds the encoding of 1.0 and w is left alone
+void bs_decodeOctFilter(void *data, size_t count, size_t stride) {
+	int8_t *bytes = data;
+	int16_t *shorts = data;
+	float max = stride == 4 ? 127.0 : 32767.0;
+
+	for(size_t i = 0; i < count; i++) {
+		float x = stride == 4 ? bytes[i * 4 + 0] : shorts[i * 4 + 0];
+		float y = stride == 4 ? bytes[i * 4 + 1] : shorts[i * 4 + 1];
+		float z = (stride == 4 ? bytes[i * 4 + 2] : shorts[i * 4 + 2]) - fabsf(x) - fabsf(y);
+
+		// Folds the lower hemisphere back
+		float t = z >= 0.0 ? 0.0 : z;
+		x += x >= 0.0 ? t : -t;
+		y += y >= 0.0 ? t : -t;
+
+		float scale = max / sqrtf(x * x + y * y + z * z);
+		int out[3] = { bs_roundSigned(x * scale), bs_roundSigned(y * scale), bs_roundSigned(z * scale) };
+
+		for(int c = 0; c < 3; c++) {
+			if(stride == 4)
+				bytes[i * 4 + c] = out[c];
+			else
+				shorts[i * 4 + c] = out[c];
+		}
+	}
+}
+
+// Smallest-three quaternions in 16 bit components, the last one holds the dropped index and the scale
+void bs_decodeQuatFilter(void *data, size_t count) {
+	int16_t *shorts = data;
+
+	for(size_t i = 0; i < count; i++) {
+		int16_t *q = shorts + i * 4;
+		float scale = 0.70710678 / (float)(q[3] | 3);
+
+		float x = q[0] * scale;
+		float y = q[1] * scale;
+		float z = q[2] * scale;
+		float ww = 1.0 - x * x - y * y - z * z;
+		float w = sqrtf(ww >= 0.0 ? ww : 0.0);
+
+		int largest = q[3] & 3;
+		q[(largest + 1) & 3] = bs_roundSigned(x * 32767.0);
+		q[(largest + 2) & 3] = bs_roundSigned(y * 32767.0);
+		q[(largest + 3) & 3] = bs_roundSigned(z * 32767.0);
+		q[largest] = (int)(w * 32767.0 + 0.5);
+	}
+}
+
+// 24 bit mantissa and 8 bit exponent per 32 bit component
+void bs_decodeExpFilter(void *data, size_t count, size_t stride) {
+	uint32_t *values = data;
+
+	for(size_t i = 0; i < count * stride / 4; i++) {
+		int32_t mantissa = (int32_t)(values[i] << 8) >> 8;
+		int32_t exponent = (int32_t)values[i] >> 24;
+
+		float value = ldexpf((float)mantissa, exponent);
+		memcpy(&values[i], &value, sizeof(float));
+	}
+}
\ No newline at end of file
@@ -3,85 +3,720 @@
 #include <cglm/cglm.h>
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <bs_models.h>
 #include <bs_core.h>
 #include <bs_textures.h>
 #include <bs_file_mgmt.h>
 #include <bs_math.h>
+#include <bs_jobs.h>
+#include <bs_assets.h>
+#include <bs_pose.h>
+#include <bs_meshopt.h>
 
+// Shared read-only root of every skeleton
 bs_Joint identity_joint = { GLM_MAT4_IDENTITY_INIT };
-bs_Anim *anims;
-int anim_count;
 
-int64_t curr_tex_ptr = 0;
-int attrib_offset = 0;
+#define BS_MODEL_CACHE_VERSION 11
+
+// Texture folder of models loaded without one
+#define BS_MODEL_TEXTURE_FOLDER "resources/models/textures/"
+
+// Cubic splines are resampled into linear keys at this rate (per second)
+#define BS_ANIM_RESAMPLE_RATE 60.0
+// Keys that interpolation reproduces within this error are dropped
+#define BS_ANIM_TOLERANCE 0.0001
+// Vertices a morph target moves less than this aren't stored
+#define BS_MORPH_TOLERANCE 0.00001
+// Node transforms within this of the identity are treated as the identity
+#define BS_NODE_TOLERANCE 0.000001
+
+// Pointers in the cache are stored as offsets from the start of the file, 0 is NULL
+#define BS_CACHE_OFFSET(offset) ((void *)(uintptr_t)(offset))
+#define BS_CACHE_FIXUP(base, ptr) ((ptr) = (ptr) == NULL ? NULL : (void *)((base) + (uintptr_t)(ptr)))
+
+typedef struct {
+	char magic[4];
+	int version;
+
+	// Structs are stored verbatim so their layout has to match
+	int pointer_size;
+	int mesh_size, prim_size, joint_size, anim_size, vertex_size, node_size;
+
+	int mesh_count, vertex_count, index_count;
+	int anim_count, tex_count, image_count;
+	int node_count;
+	int buffer_count;
+
+	uint64_t meshes;
+	uint64_t anims;
+	uint64_t nodes;
+	uint64_t textures;
+	uint64_t images;
+	// Uris of the external buffer files, the cache is stale once one of them is newer
+	uint64_t buffers;
+	uint64_t size;
+} bs_ModelCacheHeader;
+
+// Embedded images are copied into the cache so loading it never opens the model
+typedef struct {
+	uint64_t file_name;
+	uint64_t png;
+	uint64_t png_size;
+} bs_CacheImage;
+
+typedef struct {
+	unsigned char *data;
+	size_t size;
+	size_t capacity;
+} bs_CacheBuffer;
+
+typedef struct {
+	unsigned char *data;
+	size_t size;
+} bs_Arena;
+
+// Moved vertices of every target of a prim before they're copied into the arena
+typedef struct {
+	bs_MorphDelta *deltas;
+	int *target_starts;
+	int delta_count;
+} bs_RawMorphs;
+
+// A glTF mesh placed by a node of the scene, the same mesh can be placed more than once
+typedef struct {
+	cgltf_node *c_node;
+	cgltf_mesh *mesh;
+	cgltf_skin *skin;
+
+	// Model node that moves the mesh, or the world transform baked into its vertices
+	int node;
+	bs_mat4 world;
+	bool baked;
+} bs_Placement;
+
+// What's left of the scene graph once the static transforms are folded away
+typedef struct {
+	bs_Placement *placements;
+	int placement_count;
+
+	// Kept nodes, every parent ahead of its children
+	cgltf_node **nodes;
+	int node_count;
+
+	// Model node and placement of every glTF node, -1 where there is none
+	int *node_ids;
+	int *node_placements;
+} bs_Scene;
+
+// Where the pixels of an image come from, a file in the texture folder or encoded bytes in memory
+typedef struct {
+	char file_name[256];
+	const unsigned char *png;
+	size_t png_size;
+
+	// Set when the bytes were decoded from a data uri
+	bool owned;
+} bs_ModelImage;
+
+// Everything a loading job needs, nothing about a load lives in globals
+typedef struct {
+	cgltf_data *data;
+	bs_Model *model;
+	bs_Scene *scene;
+
+	// Mesh and prim index of every prim job
+	bs_ivec2 *prims;
+	// Compressed clips waiting to be copied into the arena
+	bs_Anim *clips;
+	// Sparse morph targets of every prim, in the order of prims
+	bs_RawMorphs *morphs;
+
+	// Embedded textures are keyed by the model path, the others are looked up in the folder
+	char *model_path;
+	char *texture_folder_path;
+	bs_ModelImage *images;
+} bs_ModelLoad;
+
+// Decoded glTF channel before compression
+typedef struct {
+	int path;
+	int interpolation;
+	// Floats per key, 3 or 4 for joints and the target count for weights
+	int components;
+
+	int key_count;
+	float *times;
+	float *values;
+} bs_RawChannel;
+
+/* --- ACCESSOR DECODING --- */
+// Components are converted per type in one pass, the accessor is only resolved once
+#define BS_CONVERT_ACCESSOR(in_type, out_type, scale) \
+	for(size_t i = 0; i < count; i++) { \
+		const in_type *in = (const in_type *)(src + i * stride); \
+		out_type *out = (out_type *)(dst + i * dst_stride); \
+		for(int c = 0; c < comps; c++) \
+			out[c] = in[c] * scale; \
+	}
 
-/* --- VERTEX LOADING --- */
-void bs_readPositionVertices(int accessor_index, bs_Prim *prim, cgltf_data *data) {	
-	int num_floats = cgltf_accessor_unpack_floats(&data->accessors[accessor_index], NULL, 0);
-	int num_comps = cgltf_num_components(data->accessors[accessor_index].type);
+// Signed normalized integers clamp the lowest value to -1 (KHR_mesh_quantization)
+#define BS_CONVERT_SNORM(in_type, max) \
+	for(size_t i = 0; i < count; i++) { \
+		const in_type *in = (const in_type *)(src + i * stride); \
+		float *out = (float *)(dst + i * dst_stride); \
+		for(int c = 0; c < comps; c++) \
+			out[c] = BS_MAX(in[c] / max, -1.0f); \
+	}
+
+// Element data of an accessor, NULL if it has to go through cgltf (sparse or missing buffers)
+const uint8_t *bs_accessorData(cgltf_accessor *accessor) {
+	if(accessor->is_sparse || accessor->buffer_view == NULL)
+		return NULL;
+
+	const uint8_t *data = cgltf_buffer_view_data(accessor->buffer_view);
+	if(data == NULL)
+		return NULL;
+
+	return data + accessor->offset;
+}
 
-	for(int i = 0; i < num_floats / num_comps; i++) {
-		cgltf_accessor_read_float(&data->accessors[accessor_index], i, &prim->vertices[i].position.x, num_comps);
+// Decodes comps components of every element into floats placed dst_stride bytes apart
+void bs_readAccessorFloats(cgltf_accessor *accessor, void *dst_ptr, size_t dst_stride, int comps) {
+	const uint8_t *src = bs_accessorData(accessor);
+	uint8_t *dst = dst_ptr;
+	size_t count = accessor->count;
+	size_t stride = accessor->stride;
+	comps = BS_MIN(comps, (int)cgltf_num_components(accessor->type));
+
+	if(src == NULL) {
+		int src_comps = cgltf_num_components(accessor->type);
+		float *floats = malloc(count * src_comps * sizeof(float));
+		cgltf_accessor_unpack_floats(accessor, floats, count * src_comps);
+
+		for(size_t i = 0; i < count; i++) {
+			memcpy(dst + i * dst_stride, floats + i * src_comps, comps * sizeof(float));
+		}
+
+		free(floats);
+		return;
+	}
+
+	bool normalized = accessor->normalized;
+	switch(accessor->component_type) {
+		case cgltf_component_type_r_32f:
+			// Tightly packed on both sides, e.g. into a plain float array
+			if(stride == dst_stride && stride == comps * sizeof(float)) {
+				memcpy(dst, src, count * stride);
+				break;
+			}
+
+			for(size_t i = 0; i < count; i++) {
+				memcpy(dst + i * dst_stride, src + i * stride, comps * sizeof(float));
+			}
+			break;
+		case cgltf_component_type_r_8u:
+#if defined(__SSE2__)
+			// Weights and colors are usually 4 normalized bytes
+			if(comps == 4) {
+				const __m128 scale = _mm_set1_ps(normalized ? 1.0 / 255.0 : 1.0);
+				const __m128i zero = _mm_setzero_si128();
+
+				for(size_t i = 0; i < count; i++) {
+					int32_t packed;
+					memcpy(&packed, src + i * stride, 4);
+
+					__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+					v = _mm_unpacklo_epi16(v, zero);
+					_mm_storeu_ps((float *)(dst + i * dst_stride), _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+				}
+				break;
+			}
+#endif
+			BS_CONVERT_ACCESSOR(uint8_t, float, (normalized ? 1.0f / 255.0f : 1.0f));
+			break;
+		case cgltf_component_type_r_16u:
+#if defined(__SSE2__)
+			if(comps == 4) {
+				const __m128 scale = _mm_set1_ps(normalized ? 1.0 / 65535.0 : 1.0);
+				const __m128i zero = _mm_setzero_si128();
+
+				for(size_t i = 0; i < count; i++) {
+					__m128i v = _mm_loadl_epi64((const __m128i *)(src + i * stride));
+					v = _mm_unpacklo_epi16(v, zero);
+					_mm_storeu_ps((float *)(dst + i * dst_stride), _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+				}
+				break;
+			}
+#endif
+			BS_CONVERT_ACCESSOR(uint16_t, float, (normalized ? 1.0f / 65535.0f : 1.0f));
+			break;
+		case cgltf_component_type_r_8:
+			if(normalized) {
+				BS_CONVERT_SNORM(int8_t, 127.0f);
+			} else {
+				BS_CONVERT_ACCESSOR(int8_t, float, 1.0f);
+			}
+			break;
+		case cgltf_component_type_r_16:
+			if(normalized) {
+				BS_CONVERT_SNORM(int16_t, 32767.0f);
+			} else {
+				BS_CONVERT_ACCESSOR(int16_t, float, 1.0f);
+			}
+			break;
+		case cgltf_component_type_r_32u:
+			BS_CONVERT_ACCESSOR(uint32_t, float, 1.0f);
+			break;
+		default:
+			break;
 	}
 }
 
-void bs_readNormalVertices(int accessor_index, bs_Prim *prim, cgltf_data *data) {
-	int num_floats = cgltf_accessor_unpack_floats(&data->accessors[accessor_index], NULL, 0);
-	int num_comps = cgltf_num_components(data->accessors[accessor_index].type);
+// Decodes comps integer components of every element into ints placed dst_stride bytes apart
+void bs_readAccessorInts(cgltf_accessor *accessor, void *dst_ptr, size_t dst_stride, int comps) {
+	const uint8_t *src = bs_accessorData(accessor);
+	uint8_t *dst = dst_ptr;
+	size_t count = accessor->count;
+	size_t stride = accessor->stride;
+	comps = BS_MIN(comps, (int)cgltf_num_components(accessor->type));
+
+	if(src == NULL) {
+		for(size_t i = 0; i < count; i++) {
+			cgltf_uint values[16];
+			cgltf_accessor_read_uint(accessor, i, values, comps);
+
+			for(int c = 0; c < comps; c++)
+				((int *)(dst + i * dst_stride))[c] = values[c];
+		}
+		return;
+	}
 
-	for(int i = 0; i < num_floats / num_comps; i++) {
-		cgltf_accessor_read_float(&data->accessors[accessor_index], i, &prim->vertices[i].normal.x, num_comps);
+	switch(accessor->component_type) {
+		case cgltf_component_type_r_8u:
+#if defined(__SSE2__)
+			if(comps == 4) {
+				const __m128i zero = _mm_setzero_si128();
+
+				for(size_t i = 0; i < count; i++) {
+					int32_t packed;
+					memcpy(&packed, src + i * stride, 4);
+
+					__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+					_mm_storeu_si128((__m128i *)(dst + i * dst_stride), _mm_unpacklo_epi16(v, zero));
+				}
+				break;
+			}
+#endif
+			BS_CONVERT_ACCESSOR(uint8_t, int, 1);
+			break;
+		case cgltf_component_type_r_16u:
+#if defined(__SSE2__)
+			// Packed 16 bit indices, 8 per iteration
+			if(comps == 1 && stride == 2 && dst_stride == sizeof(int)) {
+				const __m128i zero = _mm_setzero_si128();
+				size_t i = 0;
+
+				for(; i + 8 <= count; i += 8) {
+					__m128i v = _mm_loadu_si128((const __m128i *)(src + i * 2));
+					_mm_storeu_si128((__m128i *)(dst + i * 4 +  0), _mm_unpacklo_epi16(v, zero));
+					_mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_unpackhi_epi16(v, zero));
+				}
+
+				for(; i < count; i++) {
+					((int *)dst)[i] = ((const uint16_t *)src)[i];
+				}
+				break;
+			}
+
+			if(comps == 4) {
+				const __m128i zero = _mm_setzero_si128();
+
+				for(size_t i = 0; i < count; i++) {
+					__m128i v = _mm_loadl_epi64((const __m128i *)(src + i * stride));
+					_mm_storeu_si128((__m128i *)(dst + i * dst_stride), _mm_unpacklo_epi16(v, zero));
+				}
+				break;
+			}
+#endif
+			BS_CONVERT_ACCESSOR(uint16_t, int, 1);
+			break;
+		case cgltf_component_type_r_32u:
+			if(stride == dst_stride && stride == comps * sizeof(int)) {
+				memcpy(dst, src, count * stride);
+				break;
+			}
+
+			BS_CONVERT_ACCESSOR(uint32_t, int, 1);
+			break;
+		case cgltf_component_type_r_8:
+			BS_CONVERT_ACCESSOR(int8_t, int, 1);
+			break;
+		case cgltf_component_type_r_16:
+			BS_CONVERT_ACCESSOR(int16_t, int, 1);
+			break;
+		case cgltf_component_type_r_32f:
+			BS_CONVERT_ACCESSOR(float, int, 1);
+			break;
+		default:
+			break;
 	}
 }
 
-void bs_readTexCoordVertices(int accessor_index, bs_Prim *prim, cgltf_data *data) {
-	int num_floats = cgltf_accessor_unpack_floats(&data->accessors[accessor_index], NULL, 0);
-	int num_comps = cgltf_num_components(data->accessors[accessor_index].type);
+/* --- MESHOPT DECOMPRESSION --- */
+// Decoded views go into view->data, cgltf reads accessors from there and frees it with the rest
+void bs_decodeMeshoptJob(int index, void *arg) {
+	cgltf_buffer_view *view = ((cgltf_buffer_view **)arg)[index];
+	cgltf_meshopt_compression *mc = &view->meshopt_compression;
+	const uint8_t *src = (const uint8_t *)mc->buffer->data + mc->offset;
+	void *dst = malloc(BS_MAX(mc->count * mc->stride, 1));
+	bool decoded = false;
+
+	switch(mc->mode) {
+		case cgltf_meshopt_compression_mode_attributes:
+			decoded = bs_decodeVertexBuffer(dst, mc->count, mc->stride, src, mc->size); break;
+		case cgltf_meshopt_compression_mode_triangles:
+			decoded = bs_decodeIndexBuffer(dst, mc->count, mc->stride, src, mc->size); break;
+		case cgltf_meshopt_compression_mode_indices:
+			decoded = bs_decodeIndexSequence(dst, mc->count, mc->stride, src, mc->size); break;
+		default: break;
+	}
 
-	for(int i = 0; i < num_floats / num_comps; i++) {
-		cgltf_accessor_read_float(&data->accessors[accessor_index], i, &prim->vertices[i].tex_coord.x, num_comps);
+	if(decoded) {
+		switch(mc->filter) {
+			case cgltf_meshopt_compression_filter_octahedral:
+				bs_decodeOctFilter(dst, mc->count, mc->stride); break;
+			case cgltf_meshopt_compression_filter_quaternion:
+				bs_decodeQuatFilter(dst, mc->count); break;
+			case cgltf_meshopt_compression_filter_exponential:
+				bs_decodeExpFilter(dst, mc->count, mc->stride); break;
+			default: break;
+		}
+	} else {
+		free(dst);
+		dst = NULL;
 	}
 
-	if(prim->material.tex != NULL) {
-		float x_range = (float)prim->material.tex->w / BS_ATLAS_SIZE;
-		float y_range = (float)prim->material.tex->h / BS_ATLAS_SIZE;
+	view->data = dst;
+}
+
+// EXT_meshopt_compression views decode in parallel, the fallback buffers they point to are never loaded
+bool bs_decodeMeshopt(cgltf_data *data) {
+	cgltf_buffer_view **views = malloc(BS_MAX(data->buffer_views_count, 1) * sizeof(cgltf_buffer_view *));
+	int view_count = 0;
+	bool valid = true;
+
+	for(int i = 0; i < data->buffer_views_count; i++) {
+		cgltf_buffer_view *view = &data->buffer_views[i];
+		if(!view->has_meshopt_compression || view->data != NULL)
+			continue;
 
-		for(int i = 0; i < num_floats; i+=2) {
-			prim->vertices[i/2].tex_coord.x = bs_fMap(prim->vertices[i/2].tex_coord.x, 0.0, 1.0, 0.0, x_range);
-			prim->vertices[i/2].tex_coord.y = bs_fMap(prim->vertices[i/2].tex_coord.y, 0.0, 1.0, 0.0, y_range);
+		cgltf_meshopt_compression *mc = &view->meshopt_compression;
+		if(mc->buffer->data == NULL || mc->offset + mc->size > mc->buffer->size) {
+			valid = false;
+			break;
 		}
+
+		views[view_count++] = view;
+	}
+
+	if(valid)
+		bs_parallelFor(view_count, bs_decodeMeshoptJob, views);
+
+	for(int i = 0; valid && i < view_count; i++) {
+		valid = views[i]->data != NULL;
 	}
+
+	free(views);
+	return valid;
 }
 
-void bs_readJointIndices(int accessor_index, bs_Prim *prim, cgltf_data *data) {
-	int num_ints = cgltf_accessor_unpack_floats(&data->accessors[accessor_index], NULL, 0);
-	int num_comps = cgltf_num_components(data->accessors[accessor_index].type);
+/* --- SCENE GRAPH --- */
+typedef struct {
+	cgltf_data *data;
+	bs_Scene *scene;
+
+	// Per glTF node
+	bool *animated;
+	bool *dynamic;
+	bs_mat4 *worlds;
+
+	// Walked nodes in depth first order
+	cgltf_node **order;
+	int order_count;
+} bs_SceneWalk;
+
+// World transforms are computed top down once, a node is dynamic when it or one of its parents is animated
+void bs_walkNode(bs_SceneWalk *walk, cgltf_node *node, bs_mat4 parent_world, bool parent_dynamic) {
+	int index = node - walk->data->nodes;
+
+	bs_mat4 local;
+	cgltf_node_transform_local(node, (float *)local);
+	glm_mul(parent_world, local, walk->worlds[index]);
+
+	walk->dynamic[index] = parent_dynamic || walk->animated[index];
+	walk->order[walk->order_count++] = node;
+
+	if(node->mesh != NULL) {
+		bs_Scene *scene = walk->scene;
+		walk->scene->node_placements[index] = scene->placement_count;
+
+		bs_Placement *placement = &scene->placements[scene->placement_count++];
+		placement->c_node = node;
+		placement->mesh = node->mesh;
+		placement->skin = node->skin;
+		placement->node = -1;
+		placement->baked = false;
+		glm_mat4_copy(walk->worlds[index], placement->world);
+	}
 
-	for(int i = 0; i < num_ints / num_comps; i++) {
-		unsigned int xyzw[4];
+	for(int i = 0; i < node->children_count; i++) {
+		bs_walkNode(walk, node->children[i], walk->worlds[index], walk->dynamic[index]);
+	}
+}
+
+// Transforms this close to the identity aren't worth a node or a bake
+bool bs_isIdentityMatrix(bs_mat4 matrix) {
+	for(int i = 0; i < 4; i++) {
+		for(int j = 0; j < 4; j++) {
+			if(fabsf(matrix[i][j] - (i == j ? 1.0 : 0.0)) > BS_NODE_TOLERANCE)
+				return false;
+		}
+	}
 
-		cgltf_accessor_read_uint(&data->accessors[accessor_index], i, xyzw, num_comps);
-		prim->vertices[i].bone_ids.x = xyzw[0];
-		prim->vertices[i].bone_ids.y = xyzw[1];
-		prim->vertices[i].bone_ids.z = xyzw[2];
-		prim->vertices[i].bone_ids.w = xyzw[3];
+	return true;
+}
+
+bool bs_isSkinJoint(cgltf_skin *skin, cgltf_node *node) {
+	for(int i = 0; i < skin->joints_count; i++) {
+		if(skin->joints[i] == node)
+			return true;
 	}
+
+	return false;
 }
 
-void bs_readWeights(int accessor_index, bs_Prim *prim, cgltf_data *data) {
-	int num_floats = cgltf_accessor_unpack_floats(&data->accessors[accessor_index], NULL, 0);
-	int num_comps = cgltf_num_components(data->accessors[accessor_index].type);
+// glTF ignores the transform of a skinned mesh's node, the skeleton moves with the node it hangs off
+cgltf_node *bs_getSkinParent(cgltf_skin *skin) {
+	if(skin == NULL || skin->joints_count == 0)
+		return NULL;
 
-	for(int i = 0; i < num_floats / num_comps; i++) {
-		cgltf_accessor_read_float(&data->accessors[accessor_index], i, &prim->vertices[i].weights.x, num_comps);
+	cgltf_node *root = skin->joints[0];
+	while(root->parent != NULL && bs_isSkinJoint(skin, root->parent)) {
+		root = root->parent;
 	}
+
+	return root->parent;
 }
 
-void bs_loadMaterial(bs_Model *model, cgltf_primitive *c_prim, bs_Prim *prim) {
+// Static meshes get their world transform baked into the vertices. Animated and skinned meshes keep the node
+// that moves them along with its animated parents, the static nodes in between fold into the node offsets
+void bs_loadScene(cgltf_data *data, bs_Scene *scene) {
+	int node_count = data->nodes_count;
+
+	// Nothing else is placed when there are no nodes so every mesh is placed once
+	scene->placements = malloc(BS_MAX(node_count, data->meshes_count) * sizeof(bs_Placement));
+	scene->placement_count = 0;
+	scene->nodes = malloc(node_count * sizeof(cgltf_node *));
+	scene->node_count = 0;
+	scene->node_ids = malloc(node_count * sizeof(int));
+	scene->node_placements = malloc(node_count * sizeof(int));
+
+	bs_SceneWalk walk = { data, scene };
+	walk.animated = calloc(node_count, sizeof(bool));
+	walk.dynamic = calloc(node_count, sizeof(bool));
+	walk.worlds = malloc(node_count * sizeof(bs_mat4));
+	walk.order = malloc(node_count * sizeof(cgltf_node *));
+	walk.order_count = 0;
+
+	for(int i = 0; i < node_count; i++) {
+		scene->node_ids[i] = -1;
+		scene->node_placements[i] = -1;
+		glm_mat4_identity(walk.worlds[i]);
+	}
+
+	for(int i = 0; i < data->animations_count; i++) {
+		cgltf_animation *c_anim = &data->animations[i];
+
+		for(int j = 0; j < c_anim->channels_count; j++) {
+			cgltf_animation_channel *c_channel = &c_anim->channels[j];
+			if(c_channel->target_node != NULL && c_channel->target_path != cgltf_animation_path_type_weights)
+				walk.animated[c_channel->target_node - data->nodes] = true;
+		}
+	}
+
+	// Only the default scene is loaded, files without scenes show every root
+	cgltf_scene *c_scene = data->scene != NULL ? data->scene : data->scenes_count > 0 ? &data->scenes[0] : NULL;
+	bs_mat4 identity = GLM_MAT4_IDENTITY_INIT;
+
+	for(int i = 0; c_scene != NULL && i < c_scene->nodes_count; i++) {
+		bs_walkNode(&walk, c_scene->nodes[i], identity, false);
+	}
+
+	for(int i = 0; c_scene == NULL && i < node_count; i++) {
+		if(data->nodes[i].parent == NULL)
+			bs_walkNode(&walk, &data->nodes[i], identity, false);
+	}
+
+	for(int i = 0; node_count == 0 && i < data->meshes_count; i++) {
+		scene->placements[scene->placement_count++] = (bs_Placement){ NULL, &data->meshes[i], NULL, -1, GLM_MAT4_IDENTITY_INIT, false };
+	}
+
+	// Nodes that move a mesh, skinned ones by their skeleton and static ones at the identity are left out
+	cgltf_node *movers[scene->placement_count + 1];
+	bool *kept = calloc(BS_MAX(node_count, 1), sizeof(bool));
+
+	for(int i = 0; i < scene->placement_count; i++) {
+		bs_Placement *placement = &scene->placements[i];
+		cgltf_node *mover = NULL;
+
+		if(placement->skin != NULL) {
+			mover = bs_getSkinParent(placement->skin);
+
+			int index = mover != NULL ? mover - data->nodes : 0;
+			if(mover != NULL && !walk.dynamic[index] && bs_isIdentityMatrix(walk.worlds[index]))
+				mover = NULL;
+		} else {
+			if(placement->c_node != NULL && walk.dynamic[placement->c_node - data->nodes])
+				mover = placement->c_node;
+
+			placement->baked = mover == NULL && !bs_isIdentityMatrix(placement->world);
+		}
+
+		movers[i] = mover;
+		for(cgltf_node *node = mover; node != NULL; node = node->parent) {
+			if(node == mover || walk.animated[node - data->nodes])
+				kept[node - data->nodes] = true;
+		}
+	}
+
+	for(int i = 0; i < walk.order_count; i++) {
+		int index = walk.order[i] - data->nodes;
+		if(!kept[index])
+			continue;
+
+		scene->node_ids[index] = scene->node_count;
+		scene->nodes[scene->node_count++] = walk.order[i];
+	}
+
+	for(int i = 0; i < scene->placement_count; i++) {
+		if(movers[i] != NULL)
+			scene->placements[i].node = scene->node_ids[movers[i] - data->nodes];
+	}
+
+	free(kept);
+	free(walk.animated);
+	free(walk.dynamic);
+	free(walk.worlds);
+	free(walk.order);
+}
+
+void bs_freeScene(bs_Scene *scene) {
+	free(scene->placements);
+	free(scene->nodes);
+	free(scene->node_ids);
+	free(scene->node_placements);
+}
+
+void bs_loadNodes(cgltf_data *data, bs_Scene *scene, bs_Model *model) {
+	for(int i = 0; i < scene->node_count; i++) {
+		cgltf_node *c_node = scene->nodes[i];
+		bs_Node *node = &model->nodes[i];
+
+		// Folded parents are multiplied in from the bottom up until a kept one is reached
+		glm_mat4_identity(node->offset);
+		cgltf_node *parent = c_node->parent;
+
+		while(parent != NULL && scene->node_ids[parent - data->nodes] == -1) {
+			bs_mat4 local;
+			cgltf_node_transform_local(parent, (float *)local);
+			glm_mul(local, node->offset, node->offset);
+			parent = parent->parent;
+		}
+
+		node->parent = parent != NULL ? scene->node_ids[parent - data->nodes] : -1;
+		node->rest = (bs_Transform){ { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 1.0 }, { 1.0, 1.0, 1.0 } };
+
+		// Animated nodes always use TRS, a matrix can only be static
+		if(c_node->has_matrix) {
+			bs_mat4 local;
+			memcpy(local, c_node->matrix, sizeof(bs_mat4));
+			glm_mul(node->offset, local, node->offset);
+			continue;
+		}
+
+		memcpy(&node->rest.translation, c_node->translation, sizeof(bs_vec3));
+		memcpy(&node->rest.rotation, c_node->rotation, sizeof(bs_vec4));
+		memcpy(&node->rest.scale, c_node->scale, sizeof(bs_vec3));
+	}
+}
+
+// Moves a static prim into model space, normals use the inverse transpose and mirroring flips the winding
+void bs_bakePrim(bs_Prim *prim, bs_mat4 world) {
+	bs_mat4 normal_matrix;
+	glm_mat4_inv(world, normal_matrix);
+	glm_mat4_transpose(normal_matrix);
+
+	for(int i = 0; i < prim->vertex_count; i++) {
+		float *position = (float *)&prim->vertices[i].position;
+		float *normal = (float *)&prim->vertices[i].normal;
+
+		glm_mat4_mulv3(world, position, 1.0, position);
+		glm_mat4_mulv3(normal_matrix, normal, 0.0, normal);
+		glm_vec3_normalize(normal);
+	}
+
+	// Deltas are directions, they're added to the vertex before any weight is applied
+	for(int i = 0; i < prim->delta_count; i++) {
+		bs_MorphDelta *delta = &prim->deltas[i];
+		vec3 position, normal;
+
+		for(int c = 0; c < 3; c++) {
+			position[c] = bs_halfToFloat(delta->position[c]);
+			normal[c] = bs_halfToFloat(delta->normal[c]);
+		}
+
+		glm_mat4_mulv3(world, position, 0.0, position);
+		glm_mat4_mulv3(normal_matrix, normal, 0.0, normal);
+
+		for(int c = 0; c < 3; c++) {
+			delta->position[c] = bs_floatToHalf(position[c]);
+			delta->normal[c] = bs_floatToHalf(normal[c]);
+		}
+	}
+
+	if(glm_mat4_det(world) >= 0.0)
+		return;
+
+	for(int i = 0; i + 2 < prim->index_count; i += 3) {
+		int index = prim->indices[i + 1];
+		prim->indices[i + 1] = prim->indices[i + 2];
+		prim->indices[i + 2] = index;
+	}
+}
+
+/* --- VERTEX LOADING --- */
+int bs_getPrimVertexCount(cgltf_primitive *c_prim) {
+	for(int i = 0; i < c_prim->attributes_count; i++) {
+		if(c_prim->attributes[i].type == cgltf_attribute_type_position)
+			return c_prim->attributes[i].data->count;
+	}
+
+	return c_prim->attributes_count > 0 ? c_prim->attributes[0].data->count : 0;
+}
+
+void bs_loadMaterial(cgltf_data *data, bs_Model *model, cgltf_primitive *c_prim, bs_Prim *prim) {
 	cgltf_material *c_mat = c_prim->material;
 	bs_Material *mat = &prim->material;
+	mat->tex = NULL;
+	mat->tex_index = -1;
 
 	if(c_mat == NULL) {
 		mat->base_color.r = 255;
@@ -100,61 +735,69 @@ void bs_loadMaterial(bs_Model *model, cgltf_primitive *c_prim, bs_Prim *prim) {
 
 	// If the primitve has a texture
 	if(c_mat->pbr_metallic_roughness.base_color_texture.texture != NULL) {
-		int id = (int64_t)c_mat->pbr_metallic_roughness.base_color_texture.texture->image;
-		id -= curr_tex_ptr;
-		id /= sizeof(cgltf_image);
+		mat->tex_index = c_mat->pbr_metallic_roughness.base_color_texture.texture - data->textures;
 
-		mat->tex = model->textures[id];
+		// Textures aren't loaded when converting to the binary format
+		if(model->textures != NULL)
+			mat->tex = model->textures[mat->tex_index];
 	}
 }
 
-void bs_loadPrim(cgltf_data *data, bs_Mesh *mesh, bs_Model *model, int mesh_index, int prim_index) {
-	cgltf_mesh *c_mesh = &data->meshes[mesh_index];
+void bs_loadPrim(cgltf_data *data, cgltf_mesh *c_mesh, bs_Mesh *mesh, bs_Model *model, int prim_index) {
 	bs_Prim *prim = &mesh->prims[prim_index];
-	prim->material.tex = NULL;
 
 	int attrib_count = c_mesh->primitives[prim_index].attributes_count;
-	int num_floats = cgltf_accessor_unpack_floats(&data->accessors[c_mesh->primitives[prim_index].attributes[0].index], NULL, 0);
-
-	prim->vertices = malloc(num_floats * sizeof(bs_Vertex));
-	prim->vertex_count = num_floats / 3;
 
-	bs_loadMaterial(model, &c_mesh->primitives[prim_index], prim);
+	bs_loadMaterial(data, model, &c_mesh->primitives[prim_index], prim);
 
-	// Read vertices
+	// Read vertices, every attribute is decoded straight into its field
     for(int i = 0; i < attrib_count; i++) {
-    	int index = c_mesh->primitives[prim_index].attributes[i].index;
+    	cgltf_accessor *accessor = c_mesh->primitives[prim_index].attributes[i].data;
     	int type = c_mesh->primitives[prim_index].attributes[i].type;
 
+    	// Coordinates stay relative to the texture, the atlas size isn't known until it's pushed
     	switch(type) {
     		case cgltf_attribute_type_position:
-    			bs_readPositionVertices(index, prim, data); break;
+    			bs_readAccessorFloats(accessor, &prim->vertices[0].position, sizeof(bs_RVertex), 3); break;
 			case cgltf_attribute_type_normal:
-				bs_readNormalVertices(index, prim, data); break;
+				bs_readAccessorFloats(accessor, &prim->vertices[0].normal, sizeof(bs_RVertex), 3); break;
 			case cgltf_attribute_type_texcoord:
-				bs_readTexCoordVertices(index, prim, data); break;
+				bs_readAccessorFloats(accessor, &prim->vertices[0].tex_coord, sizeof(bs_RVertex), 2); break;
 			case cgltf_attribute_type_joints:
-				bs_readJointIndices(index, prim, data); break;
+				bs_readAccessorInts(accessor, &prim->vertices[0].bone_ids, sizeof(bs_RVertex), 4); break;
 			case cgltf_attribute_type_weights:
-				bs_readWeights(index, prim, data); break;
+				bs_readAccessorFloats(accessor, &prim->vertices[0].weights, sizeof(bs_RVertex), 4); break;
     	}
     }
 
-    // Read indices
-	int num_indices = cgltf_accessor_unpack_floats(c_mesh->primitives[prim_index].indices, NULL, 0);
-	prim->indices = malloc(num_indices * sizeof(int));
-	prim->index_count = num_indices;
-	for(int i = 0; i < num_indices; i++) {
-		cgltf_uint outv;
-		cgltf_accessor_read_uint(c_mesh->primitives[prim_index].indices, i, &outv, 1);
-		prim->indices[i] = outv;
+    // Read indices, unindexed prims draw their vertices in order
+	if(c_mesh->primitives[prim_index].indices == NULL) {
+		for(int i = 0; i < prim->index_count; i++) {
+			prim->indices[i] = i;
+		}
+		return;
 	}
 
-	attrib_offset = c_mesh->primitives[prim_index].index_id + 1;
+	bs_readAccessorInts(c_mesh->primitives[prim_index].indices, prim->indices, sizeof(int), 1);
+}
+
+void bs_loadPrimJob(int index, void *arg) {
+	bs_ModelLoad *load = arg;
+	bs_ivec2 prim = load->prims[index];
+
+	bs_Placement *placement = &load->scene->placements[prim.x];
+	bs_Mesh *mesh = &load->model->meshes[prim.x];
+	bs_loadPrim(load->data, placement->mesh, mesh, load->model, prim.y);
+
+	bs_Prim *c_prim = &mesh->prims[prim.y];
+	bs_RawMorphs *morphs = &load->morphs[index];
+	if(mesh->target_count > 0) {
+		memcpy(c_prim->deltas, morphs->deltas, morphs->delta_count * sizeof(bs_MorphDelta));
+		memcpy(c_prim->target_starts, morphs->target_starts, (mesh->target_count + 1) * sizeof(int));
+	}
 
-	mesh->vertex_count += prim->vertex_count;
-	model->vertex_count += prim->vertex_count;
-	model->index_count += num_indices;
+	if(placement->baked)
+		bs_bakePrim(c_prim, placement->world);
 }
 
 void bs_printMat4(bs_mat4 matrix) {
@@ -171,36 +814,50 @@ void bs_printQuat(versor q) {
 	printf("%f, %f, %f, %f\n", q[0], q[1], q[2], q[3]);
 }
 
-void bs_loadJoints(cgltf_data *data, bs_Mesh *mesh, cgltf_mesh *c_mesh) {
-	cgltf_skin *skin = c_mesh->node->skin;
-	if(skin == NULL)
+void bs_loadJoints(cgltf_data *data, bs_Mesh *mesh, cgltf_skin *skin) {
+	if(mesh->joint_count == 0)
 		return;
 
-	mesh->joints = malloc(skin->joints_count * sizeof(bs_Joint));
-	mesh->joint_count = skin->joints_count;
+	// Inverse bind matrices are identity when the skin doesn't have any
+	for(int i = 0; i < skin->joints_count; i++) {
+		glm_mat4_identity(mesh->joints[i].bind_matrix_inv);
+	}
+
+	if(skin->inverse_bind_matrices != NULL)
+		bs_readAccessorFloats(skin->inverse_bind_matrices, mesh->joints[0].bind_matrix_inv, sizeof(bs_Joint), 16);
 
 	for(int i = 0; i < skin->joints_count; i++) {
 		cgltf_node *c_joint = skin->joints[i];
 		bs_Joint *joint = &mesh->joints[i];
 
 		// Set the local matrix
-		bs_mat4 local = GLM_MAT4_IDENTITY_INIT;
-		glm_translate(local, c_joint->translation);
-		glm_quat_rotate(local, (versor){ c_joint->rotation[0], c_joint->rotation[1], c_joint->rotation[2], c_joint->rotation[3] }, local);
-		glm_scale(local, c_joint->scale);
+		memcpy(&joint->rest.translation, c_joint->translation, sizeof(bs_vec3));
+		memcpy(&joint->rest.rotation, c_joint->rotation, sizeof(bs_vec4));
+		memcpy(&joint->rest.scale, c_joint->scale, sizeof(bs_vec3));
+
+		bs_mat4 local;
+		bs_getTransformMatrix(&joint->rest, local);
 		glm_mat4_inv(local, joint->local_inv);
 
-		// Set the inverse bind matrix and regular bind matrix
-		cgltf_accessor_read_float(skin->inverse_bind_matrices, i, (float*)joint->bind_matrix_inv, 16);
+		// Set the regular bind matrix
 		glm_mat4_inv(joint->bind_matrix_inv, joint->bind_matrix);
+		glm_mat4_mul(joint->bind_matrix, joint->local_inv, joint->bind_local_inv);
 
 		memcpy(mesh->joints[i].mat, GLM_MAT4_IDENTITY, sizeof(bs_mat4));
+	}
+
+	// Nodes can be joints of several skins, every mesh keeps its own mapping
+	for(int i = 0; i < mesh->node_joint_count; i++) {
+		mesh->node_joints[i] = -1;
+	}
 
-		c_joint->id = i;
+	for(int i = 0; i < skin->joints_count; i++) {
+		mesh->node_joints[skin->joints[i] - data->nodes] = i;
 	}
 
 	for(int i = 0; i < skin->joints_count; i++) {
-		int parent_id = skin->joints[i]->parent->id;
+		cgltf_node *parent = skin->joints[i]->parent;
+		int parent_id = parent != NULL && bs_isSkinJoint(skin, parent) ? mesh->node_joints[parent - data->nodes] : -1;
 
 		// If parent id is the armature
 		if(parent_id == -1) {
@@ -210,154 +867,1326 @@ void bs_loadJoints(cgltf_data *data, bs_Mesh *mesh, cgltf_mesh *c_mesh) {
 
 		mesh->joints[i].parent = &mesh->joints[parent_id];
 	}
+
+	bs_sortJoints(mesh);
 }
 
-void bs_loadMesh(cgltf_data *data, bs_Model *model, int mesh_index) {
-	cgltf_mesh *c_mesh = &data->meshes[mesh_index];
-	cgltf_node *node = &data->nodes[mesh_index];
+void bs_loadMesh(cgltf_data *data, bs_Scene *scene, bs_Model *model, int mesh_index) {
+	bs_Placement *placement = &scene->placements[mesh_index];
+	cgltf_mesh *c_mesh = placement->mesh;
 
-	memcpy(&model->meshes[mesh_index].pos, node->translation, sizeof(bs_vec3));
-	memcpy(&model->meshes[mesh_index].rot, node->rotation, sizeof(bs_vec4));
-	memcpy(&model->meshes[mesh_index].sca, node->scale, sizeof(bs_vec4));
+	model->meshes[mesh_index].node = placement->node;
+	model->meshes[mesh_index].vertex_count = 0;
 
-	model->meshes[mesh_index].prims = malloc(c_mesh->primitives_count * sizeof(bs_Prim));
-	model->meshes[mesh_index].prim_count = c_mesh->primitives_count;
+	// Weights the file doesn't give stay at zero
+	int weight_count = BS_MIN((int)c_mesh->weights_count, model->meshes[mesh_index].target_count);
+	for(int i = 0; i < weight_count; i++) {
+		model->meshes[mesh_index].weights[i] = c_mesh->weights[i];
+	}
 
-	bs_loadJoints(data, &model->meshes[mesh_index], c_mesh);
+	// Every mesh maps nodes to its own skin, channels resolve through node_joints
+	bs_loadJoints(data, &model->meshes[mesh_index], placement->skin);
+}
 
-	for(int i = 0; i < c_mesh->primitives_count; i++) {
-		bs_loadPrim(data, &model->meshes[mesh_index], model, mesh_index, i);
+/* --- TEXTURE LOADING --- */
+// Images in a buffer view (.glb) or a data uri are decoded from memory, any other uri names a file
+void bs_readModelImage(cgltf_image *image, bs_ModelImage *out) {
+	memset(out, 0, sizeof(bs_ModelImage));
+
+	if(image->buffer_view != NULL) {
+		out->png = cgltf_buffer_view_data(image->buffer_view);
+		out->png_size = image->buffer_view->size;
+		return;
 	}
+
+	char *uri = image->uri;
+	if(uri != NULL && strncmp(uri, "data:", 5) == 0) {
+		char *base64 = strchr(uri, ',');
+		if(base64 == NULL)
+			return;
+
+		// 4 characters encode 3 bytes, padding is dropped
+		size_t length = strlen(++base64);
+		size_t size = length / 4 * 3;
+		for(size_t i = length; i > 0 && base64[i - 1] == '='; i--) {
+			size--;
+		}
+
+		cgltf_options options = {0};
+		void *png = NULL;
+		if(cgltf_load_buffer_base64(&options, size, base64, &png) == cgltf_result_success) {
+			out->png = png;
+			out->png_size = size;
+			out->owned = true;
+		}
+
+		return;
+	}
+
+	// Files are looked up by name in the texture folder, wherever the exporter put them
+	if(uri != NULL) {
+		char *name = strrchr(uri, '/');
+		snprintf(out->file_name, sizeof(out->file_name), "%s", name != NULL ? name + 1 : uri);
+		cgltf_decode_uri(out->file_name);
+	} else if(image->name != NULL) {
+		snprintf(out->file_name, sizeof(out->file_name), "%s.png", image->name);
+	}
+}
+
+void bs_freeModelImage(bs_ModelImage *image) {
+	if(image->owned)
+		free((void *)image->png);
+}
+
+bs_Tex2D *bs_acquireModelImage(char *model_path, char *texture_folder_path, int image_index, char *file_name, const unsigned char *png, size_t png_size) {
+	char path[512];
+
+	// Embedded images are only unique within their model
+	if(png != NULL) {
+		snprintf(path, sizeof(path), "%s#%d", model_path, image_index);
+		return bs_acquireTextureData(path, png, png_size, 1);
+	}
+
+	char *folder = texture_folder_path != NULL ? texture_folder_path : BS_MODEL_TEXTURE_FOLDER;
+	size_t length = strlen(folder);
+	bool separator = length > 0 && folder[length - 1] != '/' && folder[length - 1] != '\\';
+
+	snprintf(path, sizeof(path), "%s%s%s", folder, separator ? "/" : "", file_name);
+	return bs_acquireTexture(path, 1);
 }
 
-void bs_loadModelTextures(cgltf_data* data, bs_Model *model) {
+void bs_loadTextureJob(int index, void *arg) {
+	bs_ModelLoad *load = arg;
+
+	int image_index = load->data->textures[index].image - load->data->images;
+	bs_ModelImage *image = &load->images[image_index];
+
+	load->model->textures[index] = bs_acquireModelImage(load->model_path, load->texture_folder_path,
+		image_index, image->file_name, image->png, image->png_size);
+}
+
+void bs_loadModelTextures(cgltf_data* data, bs_Model *model, char *model_path, char *texture_folder_path) {
 	if(data->textures_count == 0)
 		return;
 
-	bs_Tex2D *images[data->images_count];
-	int64_t ids[data->textures_count];
+	bs_ModelLoad load = { data, model };
+	load.model_path = model_path;
+	load.texture_folder_path = texture_folder_path;
+	load.images = malloc(data->images_count * sizeof(bs_ModelImage));
 
-	for(int i = 0; i < data->textures_count; i++) {
-		// Getting the pointers to all images in the form of a 64 bit int
-		ids[i] = (int64_t)data->textures[i].image;
+	for(int i = 0; i < data->images_count; i++) {
+		bs_readModelImage(&data->images[i], &load.images[i]);
 	}
+
+	// Images decode in parallel, textures sharing an image or used by other models are only loaded once
+	bs_parallelFor(data->textures_count, bs_loadTextureJob, &load);
+
 	for(int i = 0; i < data->images_count; i++) {
-		char texture_path[256] = "resources/models/textures/";
-		strcat(texture_path, data->images[i].name);
-		strcat(texture_path, ".png");
-		images[i] = bs_loadTexture(texture_path, 1);
+		bs_freeModelImage(&load.images[i]);
+	}
+
+	free(load.images);
+}
+
+int bs_getChannelPath(cgltf_animation_channel *c_channel) {
+	switch(c_channel->target_path) {
+		case cgltf_animation_path_type_translation: return BS_CHANNEL_TRANSLATION;
+		case cgltf_animation_path_type_rotation: return BS_CHANNEL_ROTATION;
+		case cgltf_animation_path_type_scale: return BS_CHANNEL_SCALE;
+		case cgltf_animation_path_type_weights: return BS_CHANNEL_WEIGHTS;
+		default: return -1;
+	}
+}
+
+// Weight channels have one value per morph target of the mesh
+int bs_getMeshTargetCount(cgltf_mesh *c_mesh) {
+	return c_mesh != NULL && c_mesh->primitives_count > 0 ? c_mesh->primitives[0].targets_count : 0;
+}
+
+int bs_getChannelInterpolation(cgltf_animation_sampler *c_sampler) {
+	switch(c_sampler->interpolation) {
+		case cgltf_interpolation_type_step: return BS_INTERP_STEP;
+		case cgltf_interpolation_type_cubic_spline: return BS_INTERP_CUBIC;
+		default: return BS_INTERP_LINEAR;
 	}
+}
+
+int bs_getChannelComponents(cgltf_animation_channel *c_channel, int path) {
+	if(path == BS_CHANNEL_WEIGHTS)
+		return c_channel->target_node != NULL ? bs_getMeshTargetCount(c_channel->target_node->mesh) : 0;
 
- 	curr_tex_ptr = ids[0];
- 	model->textures = malloc(data->textures_count * sizeof(bs_Tex2D *));
+	return path == BS_CHANNEL_ROTATION ? 4 : 3;
+}
 
-	for(int i = 0; i < data->textures_count; i++) {
-		ids[i] -= curr_tex_ptr;
-		// Divide by sizeof image so that stride between indices in ids is at most 1
-		ids[i] /= sizeof(cgltf_image);
-		model->textures[i] = images[ids[i]];
+/* --- ANIMATION COMPRESSION --- */
+// Reads every key of a channel as floats, cubic splines keep the in-tangent, value and out-tangent of each key
+void bs_readRawChannel(cgltf_animation_channel *c_channel, bs_RawChannel *raw) {
+	raw->path = bs_getChannelPath(c_channel);
+	raw->interpolation = bs_getChannelInterpolation(c_channel->sampler);
+	raw->components = raw->path != -1 ? bs_getChannelComponents(c_channel, raw->path) : 0;
+	raw->key_count = raw->components > 0 ? c_channel->sampler->input->count : 0;
+	raw->times = NULL;
+	raw->values = NULL;
+
+	int key_size = raw->components * (raw->interpolation == BS_INTERP_CUBIC ? 3 : 1);
+	cgltf_accessor *output = c_channel->sampler->output;
+	int output_components = cgltf_num_components(output->type);
+
+	// Weights are a flat list of scalars, anything that doesn't line up with the keys is skipped
+	if(raw->key_count == 0 || output->count * output_components != (size_t)raw->key_count * key_size) {
+		raw->key_count = 0;
+		return;
 	}
+
+	raw->times = malloc(raw->key_count * sizeof(float));
+	raw->values = malloc(raw->key_count * key_size * sizeof(float));
+	bs_readAccessorFloats(c_channel->sampler->input, raw->times, sizeof(float), 1);
+	bs_readAccessorFloats(output, raw->values, output_components * sizeof(float), output_components);
 }
 
-void bs_loadAnim(cgltf_data* data, int index) {
-	cgltf_animation *c_anim = &data->animations[index];
-	bs_Anim *anim = &anims[index];
+void bs_lerpRawKeys(bs_RawChannel *raw, float *a, float *b, float t, float *out) {
+	if(raw->path != BS_CHANNEL_ROTATION) {
+		for(int i = 0; i < raw->components; i++) {
+			out[i] = a[i] + (b[i] - a[i]) * t;
+		}
+
+		return;
+	}
 
-	int joint_count = c_anim->samplers_count / 3;
-	int frame_count = cgltf_accessor_unpack_floats(c_anim->samplers[0].input, NULL, 0);
+	versor qa, qb, q;
+	memcpy(qa, a, sizeof(versor));
+	memcpy(qb, b, sizeof(versor));
+	glm_quat_slerp(qa, qb, t, q);
+	memcpy(out, q, sizeof(versor));
+}
 
-	anim->joints = malloc(joint_count * frame_count * sizeof(bs_Joint));
-	anim->joint_count = joint_count;
+// Cubic splines become linear keys at a fixed rate, the key reduction drops the ones a line already covers
+void bs_resampleCubic(bs_RawChannel *raw) {
+	if(raw->interpolation != BS_INTERP_CUBIC || raw->key_count == 0)
+		return;
 
-	int i, i3 = 0; 
-	for(i = 0; i < joint_count; i++, i3+=3) {
-		cgltf_animation_sampler *c_sampler = &c_anim->samplers[i3];
-		cgltf_animation_channel *c_channel = &c_anim->channels[i3];
+	int components = raw->components;
+	int key_size = components * 3;
+	float start = raw->times[0], end = raw->times[raw->key_count - 1];
+	int key_count = (int)ceilf((end - start) * BS_ANIM_RESAMPLE_RATE) + 1;
 
-		// Input accessor contains timings for every frame in current joint
-		// Output contains translation, rotation and scale for every frame in current joint
-		cgltf_accessor *input = c_sampler->input;
-		cgltf_accessor *translation_output = c_sampler->output + 0;
-		cgltf_accessor *rotation_output    = c_sampler->output + 1;
-		cgltf_accessor *scale_output       = c_sampler->output + 2;
+	float *times = malloc(key_count * sizeof(float));
+	float *values = malloc(key_count * components * sizeof(float));
 
-		for(int j = 0; j < frame_count; j++) {
-			int index = i + (j * joint_count);
-			bs_Joint *joint = &anim->joints[index];
+	for(int k = 0, seg = 0; k < key_count; k++) {
+		float time = BS_MIN(start + k / BS_ANIM_RESAMPLE_RATE, end);
+		float *out = values + k * components;
+		times[k] = time;
 
-			bs_mat4 joint_mat = GLM_MAT4_IDENTITY_INIT;
-			vec3   tra;
-			versor rot;
-			vec3   sca;
+		while(seg < raw->key_count - 2 && raw->times[seg + 1] <= time)
+			seg++;
 
-			cgltf_accessor_read_float(translation_output, j, (float*)&tra, 3);
-			cgltf_accessor_read_float(rotation_output   , j, (float*)&rot, 4);
-			cgltf_accessor_read_float(scale_output      , j, (float*)&sca, 3);
+		// Value sits between the tangents of a key
+		float *a = raw->values + seg * key_size + components;
+		if(raw->key_count == 1) {
+			memcpy(out, a, components * sizeof(float));
+			continue;
+		}
 
-			glm_translate(joint_mat, tra);
-			glm_quat_rotate(joint_mat, rot, joint_mat);
-			glm_scale(joint_mat, sca);
+		// Hermite spline between the out-tangent of a and the in-tangent of b
+		float *b = a + key_size;
+		float *out_tangent = a + components;
+		float *in_tangent = b - components;
+		float delta = raw->times[seg + 1] - raw->times[seg];
+		float t = delta > 0.0 ? (time - raw->times[seg]) / delta : 0.0;
+		float t2 = t * t, t3 = t2 * t;
+
+		for(int i = 0; i < components; i++) {
+			out[i] = (2.0 * t3 - 3.0 * t2 + 1.0) * a[i] + (t3 - 2.0 * t2 + t) * delta * out_tangent[i] +
+				(-2.0 * t3 + 3.0 * t2) * b[i] + (t3 - t2) * delta * in_tangent[i];
+		}
 
-			memcpy(joint->mat, joint_mat, sizeof(bs_mat4));
+		if(raw->path == BS_CHANNEL_ROTATION) {
+			versor q;
+			memcpy(q, out, sizeof(versor));
+			glm_quat_normalize(q);
+			memcpy(out, q, sizeof(versor));
 		}
 	}
+
+	free(raw->times);
+	free(raw->values);
+	raw->times = times;
+	raw->values = values;
+	raw->key_count = key_count;
+	raw->interpolation = BS_INTERP_LINEAR;
+}
+
+float bs_rawKeyError(bs_RawChannel *raw, float *a, float *b) {
+	float error = 0.0;
+
+	// q and -q are the same rotation
+	float sign = 1.0;
+	if(raw->path == BS_CHANNEL_ROTATION && a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] < 0.0)
+		sign = -1.0;
+
+	for(int i = 0; i < raw->components; i++) {
+		error = BS_MAX(error, fabsf(a[i] - b[i] * sign));
+	}
+
+	return error;
+}
+
+// Drops every key the neighbouring kept keys reproduce within BS_ANIM_TOLERANCE
+void bs_reduceRawKeys(bs_RawChannel *raw) {
+	if(raw->key_count < 2)
+		return;
+
+	int components = raw->components;
+	int kept = 1;
+	int last = 0;
+
+	for(int i = 1; i < raw->key_count - 1; i++) {
+		float *next = raw->values + (i + 1) * components;
+		bool redundant = true;
+
+		// Every key skipped since the last kept one has to stay on the new segment
+		for(int k = last + 1; k <= i && redundant; k++) {
+			float predicted[components];
+			float *key = raw->values + k * components;
+
+			if(raw->interpolation == BS_INTERP_STEP) {
+				memcpy(predicted, raw->values + last * components, components * sizeof(float));
+			} else {
+				float t = (raw->times[k] - raw->times[last]) / (raw->times[i + 1] - raw->times[last]);
+				bs_lerpRawKeys(raw, raw->values + last * components, next, t, predicted);
+			}
+
+			redundant = bs_rawKeyError(raw, predicted, key) <= BS_ANIM_TOLERANCE;
+		}
+
+		if(redundant)
+			continue;
+
+		// Kept keys are compacted in place, they only ever move backwards
+		last = i;
+		raw->times[kept] = raw->times[i];
+		memcpy(raw->values + kept * components, raw->values + i * components, components * sizeof(float));
+		kept++;
+	}
+
+	// The last key stays unless the whole channel is constant
+	int end = raw->key_count - 1;
+	float *first = raw->values;
+	float *final = raw->values + end * components;
+	bool constant = kept == 1 && bs_rawKeyError(raw, first, final) <= BS_ANIM_TOLERANCE;
+
+	if(!constant) {
+		raw->times[kept] = raw->times[end];
+		memmove(raw->values + kept * components, final, components * sizeof(float));
+		kept++;
+	}
+
+	raw->key_count = kept;
 }
 
-void bs_loadAnims(cgltf_data* data) {
-	anim_count = data->animations_count;
-	if(anim_count == 0)
+void bs_compressChannel(bs_RawChannel *raw, float duration, bs_Channel *channel) {
+	channel->path = raw->path;
+	channel->interpolation = raw->interpolation;
+	channel->key_count = raw->key_count;
+	channel->components = raw->path == BS_CHANNEL_WEIGHTS ? raw->components : 3;
+	channel->times = malloc(raw->key_count * sizeof(uint16_t));
+	channel->values = malloc(raw->key_count * channel->components * sizeof(uint16_t));
+	channel->min = (bs_vec3){ 0.0, 0.0, 0.0 };
+	channel->extent = (bs_vec3){ 0.0, 0.0, 0.0 };
+
+	if(raw->key_count == 0)
+		return;
+
+	for(int i = 0; i < raw->key_count; i++) {
+		float unit = duration > 0.0 ? raw->times[i] / duration : 0.0;
+		channel->times[i] = (uint16_t)glm_clamp(roundf(unit * 65535.0), 0.0, 65535.0);
+	}
+
+	if(raw->path == BS_CHANNEL_ROTATION) {
+		for(int i = 0; i < raw->key_count; i++) {
+			bs_packQuat(raw->values + i * 4, channel->values + i * 3);
+		}
+
+		return;
+	}
+
+	// Every weight of the channel shares one range
+	if(raw->path == BS_CHANNEL_WEIGHTS) {
+		int value_count = raw->key_count * raw->components;
+		float min = raw->values[0], max = raw->values[0];
+		for(int i = 1; i < value_count; i++) {
+			min = BS_MIN(min, raw->values[i]);
+			max = BS_MAX(max, raw->values[i]);
+		}
+
+		channel->min.x = min;
+		channel->extent.x = max - min;
+
+		for(int i = 0; i < value_count; i++) {
+			float unit = max > min ? (raw->values[i] - min) / (max - min) : 0.0;
+			channel->values[i] = (uint16_t)glm_clamp(roundf(unit * 65535.0), 0.0, 65535.0);
+		}
+
 		return;
+	}
+
+	// Translations and scales are fixed point within the range of the channel
+	vec3 min, max;
+	glm_vec3_copy(raw->values, min);
+	glm_vec3_copy(raw->values, max);
+	for(int i = 1; i < raw->key_count; i++) {
+		glm_vec3_minv(min, raw->values + i * 3, min);
+		glm_vec3_maxv(max, raw->values + i * 3, max);
+	}
+
+	channel->min = (bs_vec3){ min[0], min[1], min[2] };
+	channel->extent = (bs_vec3){ max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+
+	for(int i = 0; i < raw->key_count; i++) {
+		bs_packVec3(raw->values + i * 3, &channel->min, &channel->extent, channel->values + i * 3);
+	}
+}
+
+void bs_compressAnimJob(int index, void *arg) {
+	bs_ModelLoad *load = arg;
+	cgltf_animation *c_anim = &load->data->animations[index];
+	bs_Anim *clip = &load->clips[index];
+	bs_RawChannel *raws = malloc(c_anim->channels_count * sizeof(bs_RawChannel));
+
+	clip->channel_count = c_anim->channels_count;
+	clip->channels = malloc(clip->channel_count * sizeof(bs_Channel));
+	clip->duration = 0.0;
+
+	for(int i = 0; i < clip->channel_count; i++) {
+		bs_readRawChannel(&c_anim->channels[i], &raws[i]);
+		bs_resampleCubic(&raws[i]);
+
+		if(raws[i].key_count > 0)
+			clip->duration = BS_MAX(clip->duration, raws[i].times[raws[i].key_count - 1]);
+	}
+
+	// Times are quantized against the duration so every channel is read before any is compressed
+	for(int i = 0; i < clip->channel_count; i++) {
+		bs_reduceRawKeys(&raws[i]);
+		bs_compressChannel(&raws[i], clip->duration, &clip->channels[i]);
+
+		free(raws[i].times);
+		free(raws[i].values);
+	}
+
+	free(raws);
+}
+
+// Compressed clips are built before the layout, the arena is sized by their reduced key counts
+bs_Anim *bs_compressAnims(cgltf_data *data) {
+	if(data->animations_count == 0)
+		return NULL;
 
-	anims = malloc(anim_count * sizeof(bs_Anim));
+	bs_ModelLoad load = { data, NULL, NULL, NULL, malloc(data->animations_count * sizeof(bs_Anim)) };
+	bs_parallelFor(data->animations_count, bs_compressAnimJob, &load);
 
-	bs_loadAnim(data, 0);
+	return load.clips;
 }
 
-void bs_loadModel(char *model_path, char *texture_folder_path, bs_Model *model) {
+void bs_freeClips(bs_Anim *clips, int clip_count) {
+	for(int i = 0; i < clip_count; i++) {
+		for(int j = 0; j < clips[i].channel_count; j++) {
+			free(clips[i].channels[j].times);
+			free(clips[i].channels[j].values);
+		}
+
+		free(clips[i].channels);
+	}
+
+	free(clips);
+}
+
+// Copies the compressed clips into the arena
+void bs_loadAnims(cgltf_data* data, bs_Scene *scene, bs_Model *model, bs_Anim *clips) {
+	for(int i = 0; i < model->anim_count; i++) {
+		cgltf_animation *c_anim = &data->animations[i];
+		bs_Anim *anim = &model->anims[i];
+		anim->duration = clips[i].duration;
+
+		for(int j = 0; j < anim->channel_count; j++) {
+			cgltf_animation_channel *c_channel = &c_anim->channels[j];
+			bs_Channel *channel = &anim->channels[j];
+			bs_Channel *clip = &clips[i].channels[j];
+
+			channel->interpolation = clip->interpolation;
+			channel->min = clip->min;
+			channel->extent = clip->extent;
+			memcpy(channel->times, clip->times, clip->key_count * sizeof(uint16_t));
+			memcpy(channel->values, clip->values, clip->key_count * clip->components * sizeof(uint16_t));
+
+			int target = c_channel->target_node != NULL ? c_channel->target_node - data->nodes : -1;
+			channel->target = target;
+			channel->node = target != -1 ? scene->node_ids[target] : -1;
+			channel->mesh = -1;
+			if(channel->path == -1 || channel->key_count == 0)
+				channel->target = channel->node = -1;
+
+			// Weights animate the mesh the node placed instead of a joint
+			if(channel->path == BS_CHANNEL_WEIGHTS) {
+				channel->target = channel->node = -1;
+				if(channel->key_count > 0 && target != -1)
+					channel->mesh = scene->node_placements[target];
+			}
+		}
+	}
+}
+
+/* --- MORPH TARGETS --- */
+// Every target is read densely one at a time and only the vertices it moves are kept.
+// Prims with fewer targets than the mesh leave the rest empty
+void bs_compressMorphJob(int index, void *arg) {
+	bs_ModelLoad *load = arg;
+	bs_ivec2 prim = load->prims[index];
+	cgltf_mesh *c_mesh = load->scene->placements[prim.x].mesh;
+	cgltf_primitive *c_prim = &c_mesh->primitives[prim.y];
+	bs_RawMorphs *morphs = &load->morphs[index];
+
+	int target_count = bs_getMeshTargetCount(c_mesh);
+	int vertex_count = bs_getPrimVertexCount(c_prim);
+	int capacity = 0;
+
+	morphs->deltas = NULL;
+	morphs->target_starts = malloc((target_count + 1) * sizeof(int));
+	morphs->delta_count = 0;
+
+	float *positions = malloc(vertex_count * 3 * sizeof(float));
+	float *normals = malloc(vertex_count * 3 * sizeof(float));
+
+	for(int t = 0; t < target_count; t++) {
+		morphs->target_starts[t] = morphs->delta_count;
+		if(t >= c_prim->targets_count)
+			continue;
+
+		// Attributes a target doesn't have don't move
+		memset(positions, 0, vertex_count * 3 * sizeof(float));
+		memset(normals, 0, vertex_count * 3 * sizeof(float));
+
+		cgltf_morph_target *c_target = &c_prim->targets[t];
+		for(int i = 0; i < c_target->attributes_count; i++) {
+			cgltf_attribute *attribute = &c_target->attributes[i];
+			if(attribute->data->count != vertex_count)
+				continue;
+
+			if(attribute->type == cgltf_attribute_type_position)
+				bs_readAccessorFloats(attribute->data, positions, 3 * sizeof(float), 3);
+			else if(attribute->type == cgltf_attribute_type_normal)
+				bs_readAccessorFloats(attribute->data, normals, 3 * sizeof(float), 3);
+		}
+
+		for(int v = 0; v < vertex_count; v++) {
+			float *position = positions + v * 3;
+			float *normal = normals + v * 3;
+
+			bool moves = false;
+			for(int c = 0; c < 3; c++) {
+				moves |= fabsf(position[c]) > BS_MORPH_TOLERANCE || fabsf(normal[c]) > BS_MORPH_TOLERANCE;
+			}
+
+			if(!moves)
+				continue;
+
+			if(morphs->delta_count == capacity) {
+				capacity = BS_MAX(capacity * 2, 64);
+				morphs->deltas = realloc(morphs->deltas, capacity * sizeof(bs_MorphDelta));
+			}
+
+			bs_MorphDelta *delta = &morphs->deltas[morphs->delta_count++];
+			delta->vertex = v;
+			for(int c = 0; c < 3; c++) {
+				delta->position[c] = bs_floatToHalf(position[c]);
+				delta->normal[c] = bs_floatToHalf(normal[c]);
+			}
+		}
+	}
+
+	morphs->target_starts[target_count] = morphs->delta_count;
+
+	free(positions);
+	free(normals);
+}
+
+// Like the clips, targets are compressed before the layout so the arena is sized by the moved vertices
+bs_RawMorphs *bs_compressMorphs(cgltf_data *data, bs_Scene *scene, bs_ivec2 *prims, int prim_count) {
+	bs_ModelLoad load = { data, NULL, scene, prims, NULL, malloc(prim_count * sizeof(bs_RawMorphs)) };
+	bs_parallelFor(prim_count, bs_compressMorphJob, &load);
+
+	return load.morphs;
+}
+
+void bs_freeMorphs(bs_RawMorphs *morphs, int prim_count) {
+	for(int i = 0; i < prim_count; i++) {
+		free(morphs[i].deltas);
+		free(morphs[i].target_starts);
+	}
+
+	free(morphs);
+}
+
+/* --- ARENA --- */
+// Without data only the size is counted, that's how the arena is sized before it's allocated
+void *bs_arenaAlloc(bs_Arena *arena, size_t bytes) {
+	size_t offset = (arena->size + 15) & ~(size_t)15;
+	arena->size = offset + bytes;
+
+	if(arena->data == NULL || bytes == 0)
+		return NULL;
+
+	return arena->data + offset;
+}
+
+// Lays out every array of the model in the arena at its exact size
+// Runs once without arena data to size it and once more to hand out the memory
+void bs_layoutModel(cgltf_data *data, bs_Scene *scene, bs_Model *model, bs_Arena *arena, bs_Anim *clips, bs_RawMorphs *morphs) {
+	bool place = arena->data != NULL;
+
+	bs_Mesh *meshes = bs_arenaAlloc(arena, scene->placement_count * sizeof(bs_Mesh));
+	bs_Tex2D **textures = bs_arenaAlloc(arena, data->textures_count * sizeof(bs_Tex2D *));
+	bs_Anim *anims = bs_arenaAlloc(arena, data->animations_count * sizeof(bs_Anim));
+	bs_Node *nodes = bs_arenaAlloc(arena, scene->node_count * sizeof(bs_Node));
+
+	for(int i = 0, k = 0; i < scene->placement_count; i++) {
+		cgltf_mesh *c_mesh = scene->placements[i].mesh;
+		cgltf_skin *skin = scene->placements[i].skin;
+		int joint_count = skin != NULL ? skin->joints_count : 0;
+		int target_count = bs_getMeshTargetCount(c_mesh);
+
+		int node_joint_count = 0;
+		for(int j = 0; j < joint_count; j++) {
+			node_joint_count = BS_MAX(node_joint_count, (int)(skin->joints[j] - data->nodes) + 1);
+		}
+
+		bs_Prim *prims = bs_arenaAlloc(arena, c_mesh->primitives_count * sizeof(bs_Prim));
+		bs_Joint *joints = bs_arenaAlloc(arena, joint_count * sizeof(bs_Joint));
+		int *joint_order = bs_arenaAlloc(arena, joint_count * sizeof(int));
+		int *node_joints = bs_arenaAlloc(arena, node_joint_count * sizeof(int));
+		float *weights = bs_arenaAlloc(arena, target_count * sizeof(float));
+
+		for(int j = 0; j < c_mesh->primitives_count; j++, k++) {
+			cgltf_primitive *c_prim = &c_mesh->primitives[j];
+			int vertex_count = bs_getPrimVertexCount(c_prim);
+			int index_count = c_prim->indices != NULL ? c_prim->indices->count : vertex_count;
+			int delta_count = morphs[k].delta_count;
+
+			bs_RVertex *vertices = bs_arenaAlloc(arena, vertex_count * sizeof(bs_RVertex));
+			int *indices = bs_arenaAlloc(arena, index_count * sizeof(int));
+			bs_MorphDelta *deltas = bs_arenaAlloc(arena, delta_count * sizeof(bs_MorphDelta));
+			int *target_starts = bs_arenaAlloc(arena, (target_count > 0 ? target_count + 1 : 0) * sizeof(int));
+
+			if(place) {
+				prims[j].vertices = vertices;
+				prims[j].vertex_count = vertex_count;
+				prims[j].indices = indices;
+				prims[j].index_count = index_count;
+				prims[j].deltas = deltas;
+				prims[j].target_starts = target_starts;
+				prims[j].delta_count = delta_count;
+			}
+		}
+
+		if(place) {
+			meshes[i].prims = prims;
+			meshes[i].prim_count = c_mesh->primitives_count;
+			meshes[i].joints = joints;
+			meshes[i].joint_count = joint_count;
+			meshes[i].joint_order = joint_order;
+			meshes[i].node_joints = node_joints;
+			meshes[i].node_joint_count = node_joint_count;
+			meshes[i].target_count = target_count;
+			meshes[i].weights = weights;
+		}
+	}
+
+	for(int i = 0; i < data->animations_count; i++) {
+		bs_Anim *clip = &clips[i];
+		bs_Channel *channels = bs_arenaAlloc(arena, clip->channel_count * sizeof(bs_Channel));
+
+		for(int j = 0; j < clip->channel_count; j++) {
+			int key_count = clip->channels[j].key_count;
+			int components = clip->channels[j].components;
+
+			uint16_t *times = bs_arenaAlloc(arena, key_count * sizeof(uint16_t));
+			uint16_t *values = bs_arenaAlloc(arena, key_count * components * sizeof(uint16_t));
+
+			if(place) {
+				channels[j].path = clip->channels[j].path;
+				channels[j].key_count = key_count;
+				channels[j].components = components;
+				channels[j].times = times;
+				channels[j].values = values;
+			}
+		}
+
+		if(place) {
+			anims[i].channels = channels;
+			anims[i].channel_count = clip->channel_count;
+		}
+	}
+
+	if(place) {
+		model->meshes = meshes;
+		model->textures = textures;
+		model->anims = anims;
+		model->nodes = nodes;
+		model->mesh_count = scene->placement_count;
+		model->tex_count = data->textures_count;
+		model->anim_count = data->animations_count;
+		model->node_count = scene->node_count;
+		model->arena = arena->data;
+	}
+}
+
+/* --- BINARY CACHE --- */
+// Appends data aligned to 16 bytes and returns its offset in the file
+uint64_t bs_cacheWrite(bs_CacheBuffer *buf, const void *data, size_t bytes) {
+	size_t offset = (buf->size + 15) & ~(size_t)15;
+
+	if(offset + bytes > buf->capacity) {
+		buf->capacity = BS_MAX(buf->capacity * 2, offset + bytes);
+		buf->data = realloc(buf->data, buf->capacity);
+	}
+
+	memset(buf->data + buf->size, 0, offset - buf->size);
+	if(bytes > 0)
+		memcpy(buf->data + offset, data, bytes);
+	buf->size = offset + bytes;
+	return offset;
+}
+
+void bs_writeModelCache(char *cache_path, bs_Model *model, cgltf_data *data) {
+	bs_CacheBuffer buf = { 0 };
+	bs_ModelCacheHeader header = { { 'B', 'S', 'M', 'D' }, BS_MODEL_CACHE_VERSION, sizeof(void *),
+		sizeof(bs_Mesh), sizeof(bs_Prim), sizeof(bs_Joint), sizeof(bs_Anim), sizeof(bs_RVertex), sizeof(bs_Node) };
+
+	header.mesh_count = model->mesh_count;
+	header.vertex_count = model->vertex_count;
+	header.index_count = model->index_count;
+	header.anim_count = model->anim_count;
+	header.tex_count = data->textures_count;
+	header.image_count = data->images_count;
+	header.node_count = model->node_count;
+	bs_cacheWrite(&buf, &header, sizeof(header));
+
+	// Tables are copied verbatim, their pointers are overwritten with file offsets afterwards.
+	// buf.data moves as the file grows so entries are looked up again after every write
+	header.meshes = bs_cacheWrite(&buf, model->meshes, model->mesh_count * sizeof(bs_Mesh));
+
+	for(int i = 0; i < model->mesh_count; i++) {
+		bs_Mesh *mesh = &model->meshes[i];
+		uint64_t prims = bs_cacheWrite(&buf, mesh->prims, mesh->prim_count * sizeof(bs_Prim));
+
+		for(int j = 0; j < mesh->prim_count; j++) {
+			uint64_t vertices = bs_cacheWrite(&buf, mesh->prims[j].vertices, mesh->prims[j].vertex_count * sizeof(bs_RVertex));
+			uint64_t indices  = bs_cacheWrite(&buf, mesh->prims[j].indices, mesh->prims[j].index_count * sizeof(int));
+
+			uint64_t deltas = 0, target_starts = 0;
+			if(mesh->target_count > 0) {
+				deltas = bs_cacheWrite(&buf, mesh->prims[j].deltas, mesh->prims[j].delta_count * sizeof(bs_MorphDelta));
+				target_starts = bs_cacheWrite(&buf, mesh->prims[j].target_starts, (mesh->target_count + 1) * sizeof(int));
+			}
+
+			bs_Prim *prim = (bs_Prim *)(buf.data + prims) + j;
+			prim->vertices = BS_CACHE_OFFSET(vertices);
+			prim->indices = BS_CACHE_OFFSET(indices);
+			prim->deltas = BS_CACHE_OFFSET(deltas);
+			prim->target_starts = BS_CACHE_OFFSET(target_starts);
+			prim->material.tex = NULL;
+		}
+
+		uint64_t joints = 0;
+		if(mesh->joint_count > 0) {
+			joints = bs_cacheWrite(&buf, mesh->joints, mesh->joint_count * sizeof(bs_Joint));
+		}
+
+		for(int j = 0; j < mesh->joint_count; j++) {
+			bs_Joint *joint = (bs_Joint *)(buf.data + joints) + j;
+			int parent = mesh->joints[j].parent - mesh->joints;
+
+			// Root joints hang off the identity joint which isn't part of the mesh
+			joint->parent = (parent >= 0 && parent < mesh->joint_count) ? BS_CACHE_OFFSET(joints + parent * sizeof(bs_Joint)) : NULL;
+		}
+
+		uint64_t joint_order = bs_cacheWrite(&buf, mesh->joint_order, mesh->joint_count * sizeof(int));
+		uint64_t node_joints = bs_cacheWrite(&buf, mesh->node_joints, mesh->node_joint_count * sizeof(int));
+
+		uint64_t weights = 0;
+		if(mesh->target_count > 0) {
+			weights = bs_cacheWrite(&buf, mesh->weights, mesh->target_count * sizeof(float));
+		}
+
+		bs_Mesh *c_mesh = (bs_Mesh *)(buf.data + header.meshes) + i;
+		c_mesh->prims = BS_CACHE_OFFSET(prims);
+		c_mesh->joints = BS_CACHE_OFFSET(joints);
+		c_mesh->joint_order = BS_CACHE_OFFSET(joint_order);
+		c_mesh->node_joints = BS_CACHE_OFFSET(node_joints);
+		c_mesh->weights = BS_CACHE_OFFSET(weights);
+	}
+
+	if(model->anim_count > 0) {
+		header.anims = bs_cacheWrite(&buf, model->anims, model->anim_count * sizeof(bs_Anim));
+	}
+
+	if(model->node_count > 0) {
+		header.nodes = bs_cacheWrite(&buf, model->nodes, model->node_count * sizeof(bs_Node));
+	}
+
+	for(int i = 0; i < model->anim_count; i++) {
+		bs_Anim *anim = &model->anims[i];
+		uint64_t channels = bs_cacheWrite(&buf, anim->channels, anim->channel_count * sizeof(bs_Channel));
+
+		for(int j = 0; j < anim->channel_count; j++) {
+			bs_Channel *channel = &anim->channels[j];
+			uint64_t times  = bs_cacheWrite(&buf, channel->times, channel->key_count * sizeof(uint16_t));
+			uint64_t values = bs_cacheWrite(&buf, channel->values, channel->key_count * channel->components * sizeof(uint16_t));
+
+			bs_Channel *c_channel = (bs_Channel *)(buf.data + channels) + j;
+			c_channel->times = BS_CACHE_OFFSET(times);
+			c_channel->values = BS_CACHE_OFFSET(values);
+		}
+
+		((bs_Anim *)(buf.data + header.anims) + i)->channels = BS_CACHE_OFFSET(channels);
+	}
+
+	// Image index of every texture followed by where every image is read from
+	if(data->textures_count > 0) {
+		int tex_images[data->textures_count];
+		for(int i = 0; i < data->textures_count; i++) {
+			tex_images[i] = data->textures[i].image - data->images;
+		}
+
+		header.textures = bs_cacheWrite(&buf, tex_images, sizeof(tex_images));
+	}
+
+	if(data->images_count > 0) {
+		bs_CacheImage images[data->images_count];
+
+		for(int i = 0; i < data->images_count; i++) {
+			bs_ModelImage image;
+			bs_readModelImage(&data->images[i], &image);
+
+			images[i].file_name = bs_cacheWrite(&buf, image.file_name, strlen(image.file_name) + 1);
+			images[i].png = image.png != NULL ? bs_cacheWrite(&buf, image.png, image.png_size) : 0;
+			images[i].png_size = image.png_size;
+			bs_freeModelImage(&image);
+		}
+
+		header.images = bs_cacheWrite(&buf, images, sizeof(images));
+	}
+
+	// .glb and data uri buffers are part of the model file itself
+	uint64_t buffers[data->buffers_count + 1];
+	for(int i = 0; i < data->buffers_count; i++) {
+		char *uri = data->buffers[i].uri;
+		if(uri == NULL || strncmp(uri, "data:", 5) == 0)
+			continue;
+
+		char decoded[strlen(uri) + 1];
+		strcpy(decoded, uri);
+		cgltf_decode_uri(decoded);
+		buffers[header.buffer_count++] = bs_cacheWrite(&buf, decoded, strlen(decoded) + 1);
+	}
+
+	if(header.buffer_count > 0) {
+		header.buffers = bs_cacheWrite(&buf, buffers, header.buffer_count * sizeof(uint64_t));
+	}
+
+	header.size = buf.size;
+	memcpy(buf.data, &header, sizeof(header));
+
+	FILE *f = fopen(cache_path, "wb");
+	if(f == NULL) {
+		printf("Model cache couldn't be written: %s\n", cache_path);
+		free(buf.data);
+		return;
+	}
+
+	fwrite(buf.data, 1, buf.size, f);
+	fclose(f);
+	free(buf.data);
+}
+
+// True if count elements of size bytes at offset lie inside the cache, empty arrays can point anywhere
+bool bs_isCacheRange(bs_ModelCacheHeader *header, uint64_t offset, int64_t count, size_t size) {
+	if(count < 0)
+		return false;
+	if(count == 0)
+		return true;
+
+	// Everything is written 16 byte aligned behind the header
+	if(offset < sizeof(bs_ModelCacheHeader) || offset % 16 != 0 || offset >= header->size)
+		return false;
+
+	return (uint64_t)count <= (header->size - offset) / size;
+}
+
+#define BS_CACHE_RANGE(header, ptr, count) bs_isCacheRange(header, (uintptr_t)(ptr), count, sizeof(*(ptr)))
+
+bool bs_checkCacheMesh(unsigned char *base, bs_ModelCacheHeader *header, bs_Mesh *mesh) {
+	if(!BS_CACHE_RANGE(header, mesh->prims, mesh->prim_count) ||
+	   !BS_CACHE_RANGE(header, mesh->joints, mesh->joint_count) ||
+	   !BS_CACHE_RANGE(header, mesh->joint_order, mesh->joint_count) ||
+	   !BS_CACHE_RANGE(header, mesh->node_joints, mesh->node_joint_count) ||
+	   !BS_CACHE_RANGE(header, mesh->weights, mesh->target_count))
+		return false;
+
+	if(mesh->node < -1 || mesh->node >= header->node_count)
+		return false;
+
+	for(int i = 0; i < mesh->prim_count; i++) {
+		bs_Prim *prim = (bs_Prim *)(base + (uintptr_t)mesh->prims) + i;
+
+		if(!BS_CACHE_RANGE(header, prim->vertices, prim->vertex_count) ||
+		   !BS_CACHE_RANGE(header, prim->indices, prim->index_count) ||
+		   !BS_CACHE_RANGE(header, prim->deltas, prim->delta_count) ||
+		   !BS_CACHE_RANGE(header, prim->target_starts, mesh->target_count > 0 ? mesh->target_count + 1 : 0))
+			return false;
+
+		if(prim->material.tex_index < -1 || prim->material.tex_index >= header->tex_count)
+			return false;
+	}
+
+	// The tables the pose indexes with
+	bs_Joint *joints = (bs_Joint *)(base + (uintptr_t)mesh->joints);
+	int *joint_order = (int *)(base + (uintptr_t)mesh->joint_order);
+	int *node_joints = (int *)(base + (uintptr_t)mesh->node_joints);
+
+	for(int i = 0; i < mesh->joint_count; i++) {
+		uint64_t parent = (uintptr_t)joints[i].parent;
+		uint64_t first = (uintptr_t)mesh->joints;
+
+		if(parent != 0 && (parent < first || parent - first >= mesh->joint_count * sizeof(bs_Joint) || (parent - first) % sizeof(bs_Joint) != 0))
+			return false;
+		if(joint_order[i] < 0 || joint_order[i] >= mesh->joint_count)
+			return false;
+	}
+
+	for(int i = 0; i < mesh->node_joint_count; i++) {
+		if(node_joints[i] < -1 || node_joints[i] >= mesh->joint_count)
+			return false;
+	}
+
+	return true;
+}
+
+// Every offset and count is checked before anything is rebased, a corrupt file is rejected as a whole
+bool bs_checkModelCache(unsigned char *base, bs_ModelCacheHeader *header) {
+	if(header->mesh_count < 0 || header->anim_count < 0 || header->node_count < 0 ||
+	   header->tex_count < 0 || header->image_count < 0 || header->buffer_count < 0)
+		return false;
+
+	if(!bs_isCacheRange(header, header->meshes, header->mesh_count, sizeof(bs_Mesh)) ||
+	   !bs_isCacheRange(header, header->anims, header->anim_count, sizeof(bs_Anim)) ||
+	   !bs_isCacheRange(header, header->nodes, header->node_count, sizeof(bs_Node)) ||
+	   !bs_isCacheRange(header, header->textures, header->tex_count, sizeof(int)) ||
+	   !bs_isCacheRange(header, header->images, header->image_count, sizeof(bs_CacheImage)) ||
+	   !bs_isCacheRange(header, header->buffers, header->buffer_count, sizeof(uint64_t)))
+		return false;
+
+	int *tex_images = (int *)(base + header->textures);
+	for(int i = 0; i < header->tex_count; i++) {
+		if(tex_images[i] < 0 || tex_images[i] >= header->image_count)
+			return false;
+	}
+
+	// Strings have to end inside the file
+	bs_CacheImage *images = (bs_CacheImage *)(base + header->images);
+	for(int i = 0; i < header->image_count; i++) {
+		if(!bs_isCacheRange(header, images[i].file_name, 1, 1) || memchr(base + images[i].file_name, 0, header->size - images[i].file_name) == NULL)
+			return false;
+		if(images[i].png != 0 && (images[i].png_size > INT64_MAX || !bs_isCacheRange(header, images[i].png, images[i].png_size, 1)))
+			return false;
+	}
+
+	uint64_t *buffers = (uint64_t *)(base + header->buffers);
+	for(int i = 0; i < header->buffer_count; i++) {
+		if(!bs_isCacheRange(header, buffers[i], 1, 1) || memchr(base + buffers[i], 0, header->size - buffers[i]) == NULL)
+			return false;
+	}
+
+	bs_Mesh *meshes = (bs_Mesh *)(base + header->meshes);
+	for(int i = 0; i < header->mesh_count; i++) {
+		if(!bs_checkCacheMesh(base, header, &meshes[i]))
+			return false;
+	}
+
+	bs_Node *nodes = (bs_Node *)(base + header->nodes);
+	for(int i = 0; i < header->node_count; i++) {
+		if(nodes[i].parent < -1 || nodes[i].parent >= header->node_count)
+			return false;
+	}
+
+	bs_Anim *anims = (bs_Anim *)(base + header->anims);
+	for(int i = 0; i < header->anim_count; i++) {
+		if(!BS_CACHE_RANGE(header, anims[i].channels, anims[i].channel_count))
+			return false;
+
+		bs_Channel *channels = (bs_Channel *)(base + (uintptr_t)anims[i].channels);
+		for(int j = 0; j < anims[i].channel_count; j++) {
+			int64_t key_count = channels[j].key_count;
+
+			if(channels[j].components < 0 ||
+			   !BS_CACHE_RANGE(header, channels[j].times, key_count) ||
+			   !BS_CACHE_RANGE(header, channels[j].values, key_count * channels[j].components))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// Buffer uris are relative to the model, like cgltf resolves them
+bool bs_areCacheBuffersOlder(unsigned char *base, bs_ModelCacheHeader *header, char *model_path, long long cache_time) {
+	char *slash = strrchr(model_path, '/');
+	char *backslash = strrchr(model_path, '\\');
+	if(backslash != NULL && (slash == NULL || backslash > slash))
+		slash = backslash;
+
+	int dir_length = slash != NULL ? slash - model_path + 1 : 0;
+	uint64_t *buffers = (uint64_t *)(base + header->buffers);
+
+	for(int i = 0; i < header->buffer_count; i++) {
+		char path[512];
+		if(snprintf(path, sizeof(path), "%.*s%s", dir_length, model_path, (char *)(base + buffers[i])) >= sizeof(path))
+			return false;
+
+		if(bs_getFileTime(path) > cache_time)
+			return false;
+	}
+
+	return true;
+}
+
+bool bs_readModelCache(char *cache_path, char *model_path, char *texture_folder_path, bs_Model *model) {
+	size_t size;
+	unsigned char *base = bs_mapFile(cache_path, &size);
+	if(base == NULL)
+		return false;
+
+	bs_ModelCacheHeader *header = (bs_ModelCacheHeader *)base;
+	bool valid = size >= sizeof(bs_ModelCacheHeader) &&
+		memcmp(header->magic, "BSMD", 4) == 0 &&
+		header->version == BS_MODEL_CACHE_VERSION &&
+		header->pointer_size == sizeof(void *) &&
+		header->mesh_size == sizeof(bs_Mesh) && header->prim_size == sizeof(bs_Prim) &&
+		header->joint_size == sizeof(bs_Joint) && header->anim_size == sizeof(bs_Anim) &&
+		header->vertex_size == sizeof(bs_RVertex) && header->node_size == sizeof(bs_Node) &&
+		header->size == size &&
+		bs_checkModelCache(base, header) &&
+		bs_areCacheBuffersOlder(base, header, model_path, bs_getFileTime(cache_path));
+
+	if(!valid) {
+		bs_unmapFile(base, size);
+		return false;
+	}
+
+	model->cache_data = base;
+	model->cache_size = size;
+	model->arena = NULL;
+	model->mesh_count = header->mesh_count;
+	model->vertex_count = header->vertex_count;
+	model->index_count = header->index_count;
+	model->meshes = (bs_Mesh *)(base + header->meshes);
+	model->textures = NULL;
+	model->tex_count = header->tex_count;
+
+	// Embedded images decode straight from the mapped file
+	if(header->tex_count > 0) {
+		bs_CacheImage *images = (bs_CacheImage *)(base + header->images);
+		int *tex_images = (int *)(base + header->textures);
+		model->textures = malloc(header->tex_count * sizeof(bs_Tex2D *));
+
+		for(int i = 0; i < header->tex_count; i++) {
+			bs_CacheImage *image = &images[tex_images[i]];
+			const unsigned char *png = image->png != 0 ? base + image->png : NULL;
+
+			model->textures[i] = bs_acquireModelImage(model_path, texture_folder_path,
+				tex_images[i], (char *)(base + image->file_name), png, image->png_size);
+		}
+	}
+
+	// Only the tables are written to, vertex and index pages stay shared with the file
+	for(int i = 0; i < model->mesh_count; i++) {
+		bs_Mesh *mesh = &model->meshes[i];
+		BS_CACHE_FIXUP(base, mesh->prims);
+		BS_CACHE_FIXUP(base, mesh->joints);
+		BS_CACHE_FIXUP(base, mesh->joint_order);
+		BS_CACHE_FIXUP(base, mesh->node_joints);
+		BS_CACHE_FIXUP(base, mesh->weights);
+
+		for(int j = 0; j < mesh->prim_count; j++) {
+			bs_Prim *prim = &mesh->prims[j];
+			BS_CACHE_FIXUP(base, prim->vertices);
+			BS_CACHE_FIXUP(base, prim->indices);
+			BS_CACHE_FIXUP(base, prim->deltas);
+			BS_CACHE_FIXUP(base, prim->target_starts);
+
+			int tex_index = prim->material.tex_index;
+			prim->material.tex = tex_index == -1 ? NULL : model->textures[tex_index];
+		}
+
+		for(int j = 0; j < mesh->joint_count; j++) {
+			BS_CACHE_FIXUP(base, mesh->joints[j].parent);
+			if(mesh->joints[j].parent == NULL)
+				mesh->joints[j].parent = &identity_joint;
+		}
+	}
+
+	model->anim_count = header->anim_count;
+	model->anims = NULL;
+	if(model->anim_count > 0) {
+		model->anims = (bs_Anim *)(base + header->anims);
+	}
+
+	model->node_count = header->node_count;
+	model->nodes = NULL;
+	if(model->node_count > 0) {
+		model->nodes = (bs_Node *)(base + header->nodes);
+	}
+
+	for(int i = 0; i < model->anim_count; i++) {
+		bs_Anim *anim = &model->anims[i];
+		BS_CACHE_FIXUP(base, anim->channels);
+
+		for(int j = 0; j < anim->channel_count; j++) {
+			BS_CACHE_FIXUP(base, anim->channels[j].times);
+			BS_CACHE_FIXUP(base, anim->channels[j].values);
+		}
+	}
+
+	return true;
+}
+
+// Replaces the extension of the model with .bsm, false if the path doesn't fit
+bool bs_getModelCachePath(char *model_path, char *cache_path, size_t size) {
+	char *ext = strrchr(model_path, '.');
+	if(ext == NULL || strchr(ext, '/') != NULL)
+		ext = model_path + strlen(model_path);
+
+	int length = ext - model_path;
+	return snprintf(cache_path, size, "%.*s.bsm", length, model_path) < size;
+}
+
+// .glb files are read once, their buffers and images are views into that read
+cgltf_data *bs_parseModel(char *model_path, char *texture_folder_path, bs_Model *model, bool load_textures) {
 	cgltf_options options = {0};
 	cgltf_data* data = NULL;
 
-	// Get path to GLTF binary data
-	char bin_path[256];
-	int path_len = strlen(model_path);
-	strncpy(bin_path, model_path, path_len-4);
-	strcat(bin_path, "bin");
+	memset(model, 0, sizeof(bs_Model));
 
 	// Load the GLTF json and binary data
-	cgltf_parse_file(&options, model_path, &data);
-	cgltf_load_buffers(&options, data, bin_path);
+	if(cgltf_parse_file(&options, model_path, &data) != cgltf_result_success) {
+		printf("Model wasn't loaded: %s\n", model_path);
+		return NULL;
+	}
+
+	// Buffer uris are resolved relative to the GLTF file
+	if(cgltf_load_buffers(&options, data, model_path) != cgltf_result_success) {
+		printf("Model buffers weren't loaded: %s\n", model_path);
+		cgltf_free(data);
+		return NULL;
+	}
 
-	int mesh_count = data->meshes_count;
+	// Everything after this reads compressed views like plain ones
+	if(!bs_decodeMeshopt(data)) {
+		printf("Model buffers couldn't be decompressed: %s\n", model_path);
+		cgltf_free(data);
+		return NULL;
+	}
+
+	// Meshes of the model are the placements of glTF meshes in the scene
+	bs_Scene scene;
+	bs_loadScene(data, &scene);
+	int mesh_count = scene.placement_count;
+
+	// Every prim job works on one slot of the arena, in mesh and prim order
+	int prim_count = 0;
+	for(int i = 0; i < mesh_count; i++) {
+		prim_count += scene.placements[i].mesh->primitives_count;
+	}
+
+	bs_ModelLoad load = { data, model, &scene, malloc(prim_count * sizeof(bs_ivec2)) };
+	for(int i = 0, k = 0; i < mesh_count; i++) {
+		for(int j = 0; j < scene.placements[i].mesh->primitives_count; j++, k++) {
+			load.prims[k] = (bs_ivec2){ i, j };
+		}
+	}
+
+	bs_Anim *clips = bs_compressAnims(data);
+	load.morphs = bs_compressMorphs(data, &scene, load.prims, prim_count);
+
+	// One allocation for the whole model, sized by a dry run of the layout
+	bs_Arena arena = { NULL, 0 };
+	bs_layoutModel(data, &scene, model, &arena, clips, load.morphs);
+
+	arena.data = calloc(1, arena.size);
+	arena.size = 0;
+	bs_layoutModel(data, &scene, model, &arena, clips, load.morphs);
+
+	if(load_textures)
+		bs_loadModelTextures(data, model, model_path, texture_folder_path);
+	else
+		model->textures = NULL;
+
+	bs_loadNodes(data, &scene, model);
+	for(int i = 0; i < mesh_count; i++) {
+		bs_loadMesh(data, &scene, model, i);
+	}
 
-	model->meshes = malloc(mesh_count * sizeof(bs_Mesh));
-	model->mesh_count = mesh_count;
-	model->vertex_count = 0;
-	model->index_count = 0;
+	// Every prim decodes as its own job into the slots allocated above
+	bs_parallelFor(prim_count, bs_loadPrimJob, &load);
+	bs_freeMorphs(load.morphs, prim_count);
+	free(load.prims);
 
-	bs_loadModelTextures(data, model);
-	bs_loadAnims(data);
+	// Channels resolve their joints through the node ids set by the meshes
+	bs_loadAnims(data, &scene, model, clips);
+	bs_freeClips(clips, model->anim_count);
+	bs_freeScene(&scene);
 
 	for(int i = 0; i < mesh_count; i++) {
-		bs_loadMesh(data, model, i);
+		bs_Mesh *mesh = &model->meshes[i];
+
+		for(int j = 0; j < mesh->prim_count; j++) {
+			mesh->vertex_count += mesh->prims[j].vertex_count;
+			model->index_count += mesh->prims[j].index_count;
+		}
+
+		model->vertex_count += mesh->vertex_count;
+	}
+
+	return data;
+}
+
+// Compiles a glTF model into the binary format without loading its textures
+void bs_convertModel(char *model_path, char *cache_path) {
+	bs_Model model;
+	cgltf_data *data = bs_parseModel(model_path, NULL, &model, false);
+	if(data == NULL)
+		return;
+
+	bs_writeModelCache(cache_path, &model, data);
+
+	bs_freeModel(&model);
+	cgltf_free(data);
+}
+
+// Loads from the binary cache next to the model, the cache is (re)built when missing or older than the model
+// Returns false if the model couldn't be read, it's left empty then
+bool bs_loadModel(char *model_path, char *texture_folder_path, bs_Model *model) {
+	// Paths too long for the cache name load straight from the model
+	char cache_path[512];
+	bool cached = bs_getModelCachePath(model_path, cache_path, sizeof(cache_path));
+
+	if(cached && bs_getFileTime(cache_path) >= bs_getFileTime(model_path) && bs_readModelCache(cache_path, model_path, texture_folder_path, model))
+		return true;
+
+	cgltf_data *data = bs_parseModel(model_path, texture_folder_path, model, true);
+	if(data == NULL)
+		return false;
+
+	if(cached)
+		bs_writeModelCache(cache_path, model, data);
+	cgltf_free(data);
+	return true;
+}
+
+void bs_freeModel(bs_Model *model) {
+	// Shared poses are keyed on the model address, which may be reused
+	bs_releasePoses(model);
+
+	// Textures are shared through the asset registry
+	for(int i = 0; model->textures != NULL && i < model->tex_count; i++) {
+		bs_releaseAsset(model->textures[i]);
+	}
+
+	// Everything else lives in either the mapped cache or the arena
+	if(model->cache_data != NULL) {
+		free(model->textures);
+		bs_unmapFile(model->cache_data, model->cache_size);
+	}
+
+	free(model->arena);
+	memset(model, 0, sizeof(bs_Model));
+}
+
+/* --- INSTANCES --- */
+void bs_createModelInstance(bs_ModelInstance *instance, bs_Model *model) {
+	instance->model = model;
+	instance->pos = (bs_vec3){ 0.0, 0.0, 0.0 };
+	instance->rot = (bs_vec4){ 0.0, 0.0, 0.0, 1.0 };
+	instance->sca = (bs_vec3){ 1.0, 1.0, 1.0 };
+
+	instance->pose_count = model->node_count;
+	for(int i = 0; i < model->mesh_count; i++) {
+		instance->pose_count += model->meshes[i].joint_count;
+	}
+
+	instance->anim = model->anim_count > 0 ? &model->anims[0] : NULL;
+	instance->time = 0.0;
+	instance->lod = 0;
+
+	// Weights start at the defaults of the meshes
+	instance->weight_count = 0;
+	for(int i = 0; i < model->mesh_count; i++) {
+		instance->weight_count += model->meshes[i].target_count;
 	}
+
+	instance->weights = malloc(instance->weight_count * sizeof(float));
+	bs_sampleWeights(model, NULL, 0.0, instance->weights);
+
+	instance->pose = malloc(instance->pose_count * sizeof(bs_mat4));
+	bs_animateModel(model, NULL, 0.0, INT_MAX, instance->pose);
 }
 
-void bs_animate(bs_Mesh *mesh, bs_Anim *anim, int frame) {
-	for(int i = 0; i < anim->joint_count; i++) {
-		bs_Joint *change_joint = &mesh->joints[i];
-		bs_Joint *parent = mesh->joints[i].parent;
+void bs_freeModelInstance(bs_ModelInstance *instance) {
+	free(instance->pose);
+	free(instance->weights);
+	instance->pose = NULL;
+	instance->pose_count = 0;
+	instance->weights = NULL;
+	instance->weight_count = 0;
+}
+
+// Joint matrices of one mesh of the instance
+bs_mat4 *bs_getInstancePose(bs_ModelInstance *instance, int mesh_index) {
+	bs_mat4 *pose = instance->pose;
+
+	for(int i = 0; i < mesh_index; i++) {
+		pose += instance->model->meshes[i].joint_count;
+	}
+
+	return pose;
+}
 
-		memcpy(change_joint->mat, change_joint->bind_matrix, sizeof(bs_mat4));
+void bs_getInstanceMatrix(bs_ModelInstance *instance, bs_mat4 matrix) {
+	glm_mat4_identity(matrix);
+	glm_translate(matrix, (vec3){ instance->pos.x, instance->pos.y, instance->pos.z });
+	glm_quat_rotate(matrix, (versor){ instance->rot.x, instance->rot.y, instance->rot.z, instance->rot.w }, matrix);
+	glm_scale(matrix, (vec3){ instance->sca.x, instance->sca.y, instance->sca.z });
+}
 
-		glm_mat4_mul(change_joint->mat, change_joint->local_inv, change_joint->mat);
-		glm_mat4_mul(change_joint->mat, anim->joints[i + frame * anim->joint_count].mat, change_joint->mat);
-		glm_mat4_mul(change_joint->mat, change_joint->bind_matrix_inv, change_joint->mat);
-		glm_mat4_mul(parent->mat, change_joint->mat, change_joint->mat);
-		
-		bs_uniform_mat4(change_joint->loc, change_joint->mat);
+// Geometry that maps UVs into the atlas up front can only be built once this is true
+bool bs_areModelTexturesPacked(bs_Model *model) {
+	for(int i = 0; i < model->tex_count; i++) {
+		if(model->textures[i] != NULL && !bs_isTexturePacked(model->textures[i]))
+			return false;
 	}
+
+	return true;
 }
 
-bs_Anim *bs_getAnims() {
-	return anims;
+// World transform of a rigid mesh of the instance, skinned meshes already carry their node in the pose
+void bs_getInstanceMeshMatrix(bs_ModelInstance *instance, int mesh_index, bs_mat4 matrix) {
+	bs_getInstanceMatrix(instance, matrix);
+
+	bs_Mesh *mesh = &instance->model->meshes[mesh_index];
+	if(mesh->node < 0 || mesh->joint_count > 0)
+		return;
+
+	bs_mat4 *nodes = instance->pose + instance->pose_count - instance->model->node_count;
+	glm_mul(matrix, nodes[mesh->node], matrix);
 }
\ No newline at end of file
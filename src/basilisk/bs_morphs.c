@@ -0,0 +1,168 @@
+// GL
+#include <glad/glad.h>
+
+// Basilisk
+#include <bs_morphs.h>
+#include <bs_core.h>
+#include <bs_shaders.h>
+#include <bs_math.h>
+
+// STD
+#include <stdlib.h>
+#include <string.h>
+
+/* --- CPU BLENDING --- */
+// Fallback for when the vertices are needed on the CPU, vertices start as a copy of the prim vertices.
+// Only the targets with a weight are touched so the cost follows what actually deforms
+void bs_morphPrim(bs_Prim *prim, float *weights, int target_count, bs_RVertex *vertices) {
+    for(int t = 0; t < target_count; t++) {
+        float weight = weights[t];
+        if(weight == 0.0)
+            continue;
+
+        for(int i = prim->target_starts[t]; i < prim->target_starts[t + 1]; i++) {
+            bs_MorphDelta *delta = &prim->deltas[i];
+            float *position = (float *)&vertices[delta->vertex].position;
+            float *normal = (float *)&vertices[delta->vertex].normal;
+
+            for(int c = 0; c < 3; c++) {
+                position[c] += bs_halfToFloat(delta->position[c]) * weight;
+                normal[c] += bs_halfToFloat(delta->normal[c]) * weight;
+            }
+        }
+    }
+}
+
+/* --- GPU BLENDING --- */
+// Deltas keep the per target grouping of the prims so the shader only walks the active targets,
+// the prims of a mesh are concatenated so every target stays sorted by vertex
+void bs_createMorphBuffer(bs_MorphBuffer *morphs, bs_Model *model) {
+    morphs->delta_count = 0;
+    morphs->weight_count = 0;
+    morphs->active_count = 0;
+
+    for(int i = 0; i < model->mesh_count; i++) {
+        bs_Mesh *mesh = &model->meshes[i];
+        morphs->weight_count += mesh->target_count;
+
+        for(int j = 0; j < mesh->prim_count && mesh->joint_count > 0 && mesh->target_count > 0; j++) {
+            morphs->delta_count += mesh->prims[j].delta_count;
+        }
+    }
+
+    int texel_count = morphs->weight_count + morphs->delta_count * 2 + 1;
+    float (*texels)[4] = calloc(texel_count, sizeof(*texels));
+    int texel = morphs->weight_count;
+    int vertex_base = 0, weight_base = 0;
+
+    for(int i = 0; i < model->mesh_count; i++) {
+        bs_Mesh *mesh = &model->meshes[i];
+
+        // Targets of meshes that aren't skinned keep an empty range
+        for(int t = 0; t < mesh->target_count && mesh->joint_count > 0; t++) {
+            float *range = texels[weight_base + t];
+            range[0] = texel;
+
+            for(int j = 0, prim_base = vertex_base; j < mesh->prim_count; j++) {
+                bs_Prim *prim = &mesh->prims[j];
+
+                for(int k = prim->target_starts[t]; k < prim->target_starts[t + 1]; k++) {
+                    bs_MorphDelta *delta = &prim->deltas[k];
+                    float *position = texels[texel++];
+                    float *normal = texels[texel++];
+
+                    for(int c = 0; c < 3; c++) {
+                        position[c] = bs_halfToFloat(delta->position[c]);
+                        normal[c] = bs_halfToFloat(delta->normal[c]);
+                    }
+
+                    position[3] = prim_base + delta->vertex;
+                }
+
+                prim_base += prim->vertex_count;
+            }
+
+            range[1] = (texel - range[0]) / 2;
+        }
+
+        for(int j = 0; j < mesh->prim_count && mesh->joint_count > 0; j++) {
+            vertex_base += mesh->prims[j].vertex_count;
+        }
+
+        weight_base += mesh->target_count;
+    }
+
+    glGenBuffers(1, &morphs->delta_buffer);
+    glGenTextures(1, &morphs->delta_texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, morphs->delta_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, texel_count * sizeof(*texels), texels, GL_STATIC_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, morphs->delta_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, morphs->delta_buffer);
+
+    // Active targets change every frame, the first texel holds their count
+    morphs->active = malloc((morphs->weight_count + 1) * 2 * sizeof(float));
+    glGenBuffers(1, &morphs->weight_buffer);
+    glGenTextures(1, &morphs->weight_texture);
+    glBindBuffer(GL_TEXTURE_BUFFER, morphs->weight_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (morphs->weight_count + 1) * 2 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, morphs->weight_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, morphs->weight_buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    free(texels);
+}
+
+void bs_freeMorphBuffer(bs_MorphBuffer *morphs) {
+    glDeleteTextures(1, &morphs->delta_texture);
+    glDeleteTextures(1, &morphs->weight_texture);
+    glDeleteBuffers(1, &morphs->delta_buffer);
+    glDeleteBuffers(1, &morphs->weight_buffer);
+    free(morphs->active);
+
+    morphs->active = NULL;
+    morphs->delta_count = morphs->weight_count = morphs->active_count = 0;
+}
+
+// Only the targets with a weight are listed, inactive ones cost the shader nothing
+void bs_uploadMorphWeights(bs_MorphBuffer *morphs, float *weights) {
+    morphs->active_count = 0;
+
+    for(int t = 0; t < morphs->weight_count; t++) {
+        if(weights[t] == 0.0)
+            continue;
+
+        float *active = &morphs->active[(morphs->active_count + 1) * 2];
+        active[0] = t;
+        active[1] = weights[t];
+        morphs->active_count++;
+    }
+
+    morphs->active[0] = morphs->active_count;
+    morphs->active[1] = 0.0;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, morphs->weight_buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, (morphs->active_count + 1) * 2 * sizeof(float), morphs->active);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void bs_setMorphUniforms(bs_Shader *shader, bs_MorphBuffer *morphs) {
+    bs_Uniform *deltas = &shader->uniforms[UNIFORM_MORPH_DELTAS];
+    bs_Uniform *weights = &shader->uniforms[UNIFORM_MORPH_WEIGHTS];
+
+    if(deltas->is_valid) {
+        glActiveTexture(GL_TEXTURE0 + BS_MORPH_DELTA_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, morphs->delta_texture);
+        bs_uniform_int(deltas->loc, BS_MORPH_DELTA_UNIT);
+    }
+
+    if(weights->is_valid) {
+        glActiveTexture(GL_TEXTURE0 + BS_MORPH_WEIGHT_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, morphs->weight_texture);
+        bs_uniform_int(weights->loc, BS_MORPH_WEIGHT_UNIT);
+    }
+
+    // bs_selectAtlas binds on the active unit
+    glActiveTexture(GL_TEXTURE0);
+}
\ No newline at end of file
@@ -0,0 +1,612 @@
+#include <cglm/cglm.h>
+
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include <bs_pose.h>
+#include <bs_core.h>
+#include <bs_math.h>
+#include <bs_jobs.h>
+
+/* --- CHANNELS --- */
+// Smallest-three: the largest component is dropped and rebuilt from the unit length,
+// the other three fit in 15 bits each and the two high bits hold the dropped index
+void bs_packQuat(float *rotation, uint16_t *packed) {
+	versor q;
+	memcpy(q, rotation, sizeof(versor));
+	glm_quat_normalize(q);
+
+	int largest = 0;
+	for(int i = 1; i < 4; i++) {
+		if(fabsf(q[i]) > fabsf(q[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation, the dropped component is always positive
+	float sign = q[largest] < 0.0 ? -1.0 : 1.0;
+
+	for(int i = 0, j = 0; i < 4; i++) {
+		if(i == largest)
+			continue;
+
+		// The remaining components lie within +-1/sqrt(2)
+		float unit = q[i] * sign * GLM_SQRT1_2f + 0.5;
+		packed[j++] = (uint16_t)glm_clamp(roundf(unit * 32767.0), 0.0, 32767.0);
+	}
+
+	packed[0] |= (largest & 1) << 15;
+	packed[1] |= (largest >> 1) << 15;
+}
+
+void bs_unpackQuat(uint16_t *packed, float *rotation) {
+	int largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+	float sum = 0.0;
+
+	for(int i = 0, j = 0; i < 4; i++) {
+		if(i == largest)
+			continue;
+
+		rotation[i] = ((packed[j++] & 0x7FFF) / 32767.0 - 0.5) * GLM_SQRT2f;
+		sum += rotation[i] * rotation[i];
+	}
+
+	rotation[largest] = sqrtf(BS_MAX(1.0 - sum, 0.0));
+}
+
+// Fixed point within the range of the channel
+void bs_packVec3(float *vector, bs_vec3 *min, bs_vec3 *extent, uint16_t *packed) {
+	float *lo = (float *)min, *range = (float *)extent;
+
+	for(int i = 0; i < 3; i++) {
+		float unit = range[i] > 0.0 ? (vector[i] - lo[i]) / range[i] : 0.0;
+		packed[i] = (uint16_t)glm_clamp(roundf(unit * 65535.0), 0.0, 65535.0);
+	}
+}
+
+void bs_unpackVec3(uint16_t *packed, bs_vec3 *min, bs_vec3 *extent, float *vector) {
+	float *lo = (float *)min, *range = (float *)extent;
+
+	for(int i = 0; i < 3; i++) {
+		vector[i] = lo[i] + packed[i] / 65535.0 * range[i];
+	}
+}
+
+// Weights share one range, min.x to min.x + extent.x
+void bs_unpackWeights(uint16_t *packed, int count, bs_vec3 *min, bs_vec3 *extent, float *weights) {
+	for(int i = 0; i < count; i++) {
+		weights[i] = min->x + packed[i] / 65535.0 * extent->x;
+	}
+}
+
+void bs_decodeKey(bs_Channel *channel, int key, float *out) {
+	uint16_t *packed = channel->values + key * channel->components;
+
+	if(channel->path == BS_CHANNEL_ROTATION)
+		bs_unpackQuat(packed, out);
+	else if(channel->path == BS_CHANNEL_WEIGHTS)
+		bs_unpackWeights(packed, channel->components, &channel->min, &channel->extent, out);
+	else
+		bs_unpackVec3(packed, &channel->min, &channel->extent, out);
+}
+
+// Keys are decoded straight into out, nothing is expanded ahead of time
+void bs_sampleChannel(bs_Anim *anim, bs_Channel *channel, float time, float *out) {
+	int components = channel->path == BS_CHANNEL_ROTATION ? 4 : 3;
+	uint16_t *times = channel->times;
+	int last = channel->key_count - 1;
+
+	// Key times are stored as a fraction of the clip
+	float key_time = anim->duration > 0.0 ? time / anim->duration * 65535.0 : 0.0;
+
+	// Clamp outside of the keyed range
+	if(last == 0 || key_time <= times[0]) {
+		bs_decodeKey(channel, 0, out);
+		return;
+	}
+
+	if(key_time >= times[last]) {
+		bs_decodeKey(channel, last, out);
+		return;
+	}
+
+	// Last key at or before time
+	int lo = 0, hi = last;
+	while(hi - lo > 1) {
+		int mid = (lo + hi) / 2;
+		if(times[mid] <= key_time)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if(channel->interpolation == BS_INTERP_STEP) {
+		bs_decodeKey(channel, lo, out);
+		return;
+	}
+
+	float t = (key_time - times[lo]) / (float)(times[hi] - times[lo]);
+
+	// A mesh can have any number of targets, the fixed point weights are blended before they're decoded
+	if(channel->path == BS_CHANNEL_WEIGHTS) {
+		uint16_t *a = channel->values + lo * channel->components;
+		uint16_t *b = channel->values + hi * channel->components;
+
+		for(int i = 0; i < channel->components; i++) {
+			out[i] = channel->min.x + (a[i] + (b[i] - a[i]) * t) / 65535.0 * channel->extent.x;
+		}
+
+		return;
+	}
+
+	versor a, b, q;
+	bs_decodeKey(channel, lo, a);
+	bs_decodeKey(channel, hi, b);
+
+	if(channel->path == BS_CHANNEL_ROTATION)
+		glm_quat_slerp(a, b, t, q);
+	else
+		glm_vec3_lerp(a, b, t, q);
+
+	memcpy(out, q, components * sizeof(float));
+}
+
+// Local transform of every joint of the mesh at time, joints without channels keep their rest pose
+// Joints deeper than max_depth keep their rest transform, their channels aren't sampled at all
+void bs_sampleAnimDepth(bs_Mesh *mesh, bs_Anim *anim, float time, int max_depth, bs_Transform *locals) {
+	for(int i = 0; i < mesh->joint_count; i++) {
+		locals[i] = mesh->joints[i].rest;
+	}
+
+	for(int i = 0; anim != NULL && i < anim->channel_count; i++) {
+		bs_Channel *channel = &anim->channels[i];
+		if(channel->target < 0 || channel->target >= mesh->node_joint_count)
+			continue;
+
+		int joint = mesh->node_joints[channel->target];
+		if(joint == -1 || mesh->joints[joint].depth > max_depth)
+			continue;
+
+		bs_Transform *local = &locals[joint];
+		float *out = channel->path == BS_CHANNEL_TRANSLATION ? (float *)&local->translation :
+					 channel->path == BS_CHANNEL_ROTATION ? (float *)&local->rotation : (float *)&local->scale;
+
+		bs_sampleChannel(anim, channel, time, out);
+	}
+}
+
+void bs_sampleAnim(bs_Mesh *mesh, bs_Anim *anim, float time, bs_Transform *locals) {
+	bs_sampleAnimDepth(mesh, anim, time, INT_MAX, locals);
+}
+
+// Morph weights of every mesh back to back (bs_ModelInstance.weights), meshes without a channel keep their defaults
+void bs_sampleWeights(bs_Model *model, bs_Anim *anim, float time, float *weights) {
+	if(model->mesh_count == 0)
+		return;
+
+	int offsets[model->mesh_count];
+	int weight_count = 0;
+
+	for(int i = 0; i < model->mesh_count; i++) {
+		bs_Mesh *mesh = &model->meshes[i];
+		offsets[i] = weight_count;
+
+		for(int j = 0; j < mesh->target_count; j++) {
+			weights[weight_count++] = mesh->weights[j];
+		}
+	}
+
+	for(int i = 0; anim != NULL && i < anim->channel_count; i++) {
+		bs_Channel *channel = &anim->channels[i];
+		if(channel->path != BS_CHANNEL_WEIGHTS || channel->mesh < 0 || channel->mesh >= model->mesh_count || channel->key_count == 0)
+			continue;
+
+		if(channel->components != model->meshes[channel->mesh].target_count)
+			continue;
+
+		bs_sampleChannel(anim, channel, time, weights + offsets[channel->mesh]);
+	}
+}
+
+// Same as bs_sampleAnimDepth for the model nodes
+void bs_sampleNodes(bs_Model *model, bs_Anim *anim, float time, bs_Transform *locals) {
+	for(int i = 0; i < model->node_count; i++) {
+		locals[i] = model->nodes[i].rest;
+	}
+
+	for(int i = 0; anim != NULL && i < anim->channel_count; i++) {
+		bs_Channel *channel = &anim->channels[i];
+		if(channel->node < 0 || channel->node >= model->node_count || channel->path == BS_CHANNEL_WEIGHTS)
+			continue;
+
+		bs_Transform *local = &locals[channel->node];
+		float *out = channel->path == BS_CHANNEL_TRANSLATION ? (float *)&local->translation :
+					 channel->path == BS_CHANNEL_ROTATION ? (float *)&local->rotation : (float *)&local->scale;
+
+		bs_sampleChannel(anim, channel, time, out);
+	}
+}
+
+/* --- JOINTS --- */
+// Roots hang off a joint outside of the mesh (the shared identity joint)
+bool bs_isMeshJoint(bs_Mesh *mesh, bs_Joint *joint) {
+	return joint >= mesh->joints && joint < mesh->joints + mesh->joint_count;
+}
+
+// Builds the matrix straight from the quaternion instead of chaining translate, rotate and scale
+void bs_getTransformMatrix(bs_Transform *transform, bs_mat4 matrix) {
+	versor rotation;
+	memcpy(rotation, &transform->rotation, sizeof(versor));
+
+	glm_quat_mat4(rotation, matrix);
+	glm_vec4_scale(matrix[0], transform->scale.x, matrix[0]);
+	glm_vec4_scale(matrix[1], transform->scale.y, matrix[1]);
+	glm_vec4_scale(matrix[2], transform->scale.z, matrix[2]);
+	matrix[3][0] = transform->translation.x;
+	matrix[3][1] = transform->translation.y;
+	matrix[3][2] = transform->translation.z;
+}
+
+// glTF doesn't order joints, the evaluation order puts every parent before its children
+void bs_sortJoints(bs_Mesh *mesh) {
+	int count = mesh->joint_count;
+	if(count == 0)
+		return;
+
+	int depths[count];
+	int max_depth = 0;
+
+	for(int i = 0; i < count; i++) {
+		depths[i] = 0;
+
+		// Bounded by the joint count in case the skin has a cycle
+		bs_Joint *parent = mesh->joints[i].parent;
+		while(bs_isMeshJoint(mesh, parent) && depths[i] < count) {
+			parent = parent->parent;
+			depths[i]++;
+		}
+
+		mesh->joints[i].depth = depths[i];
+		max_depth = BS_MAX(max_depth, depths[i]);
+	}
+
+	// Counting sort by depth, joints on the same level keep their storage order
+	int starts[max_depth + 2];
+	memset(starts, 0, sizeof(starts));
+
+	for(int i = 0; i < count; i++) {
+		starts[depths[i] + 1]++;
+	}
+
+	for(int i = 1; i <= max_depth + 1; i++) {
+		starts[i] += starts[i - 1];
+	}
+
+	for(int i = 0; i < count; i++) {
+		mesh->joint_order[starts[depths[i]]++] = i;
+	}
+}
+
+/* --- EVALUATION --- */
+float bs_wrapAnimTime(bs_Anim *anim, float time) {
+	if(anim->duration <= 0.0)
+		return 0.0;
+
+	time = fmodf(time, anim->duration);
+	return time < 0.0 ? time + anim->duration : time;
+}
+
+// Time isn't wrapped, the channels hold their first and last keys outside of the clip.
+// Joints below max_depth follow their parent rigidly, at rest the skin matrix
+// bind * local_inv * rest * bind_inv is the identity so the parent pose is copied as is
+void bs_animateDepth(bs_Mesh *mesh, bs_Anim *anim, float time, int max_depth, bs_mat4 *pose) {
+	if(mesh->joint_count == 0)
+		return;
+
+	bs_Transform locals[mesh->joint_count];
+	bs_sampleAnimDepth(mesh, anim, time, max_depth, locals);
+
+	// Every matrix in the chain is affine so the cheaper SIMD affine multiply is used throughout
+	for(int k = 0; k < mesh->joint_count; k++) {
+		int i = mesh->joint_order[k];
+		bs_Joint *joint = &mesh->joints[i];
+
+		// Roots are at depth 0 so a masked joint always has a parent in the mesh
+		if(joint->depth > max_depth) {
+			glm_mat4_copy(pose[joint->parent - mesh->joints], pose[i]);
+			continue;
+		}
+
+		bs_mat4 local, skin;
+		bs_getTransformMatrix(&locals[i], local);
+
+		// bind * local_inv is constant and precomputed at load
+		glm_mul(joint->bind_local_inv, local, skin);
+		glm_mul(skin, joint->bind_matrix_inv, skin);
+
+		if(bs_isMeshJoint(mesh, joint->parent))
+			glm_mul(pose[joint->parent - mesh->joints], skin, pose[i]);
+		else
+			glm_mat4_copy(skin, pose[i]);
+	}
+}
+
+// Writes the joint matrices into pose (bs_getInstancePose), the shared mesh is left untouched
+// Time is in seconds and wraps around the clip. The pose is one contiguous palette,
+// it's sent with bs_setJointsUniform or packed with other instances through bs_pushPalette
+void bs_animate(bs_Mesh *mesh, bs_Anim *anim, float time, bs_mat4 *pose) {
+	bs_animateDepth(mesh, anim, bs_wrapAnimTime(anim, time), INT_MAX, pose);
+}
+
+// World matrix of every node, there are only as many as the model has animated or skinned meshes
+void bs_animateNodes(bs_Model *model, bs_Anim *anim, float time, bs_mat4 *matrices) {
+	if(model->node_count == 0)
+		return;
+
+	bs_Transform locals[model->node_count];
+	bs_sampleNodes(model, anim, time, locals);
+
+	for(int i = 0; i < model->node_count; i++) {
+		bs_Node *node = &model->nodes[i];
+
+		bs_mat4 local;
+		bs_getTransformMatrix(&locals[i], local);
+		glm_mul(node->offset, local, matrices[i]);
+
+		if(node->parent >= 0)
+			glm_mul(matrices[node->parent], matrices[i], matrices[i]);
+	}
+}
+
+// Fills a whole instance pose, anim can be NULL for the rest pose.
+// The joints of a mesh with a node are moved by it so every pose consumer gets model space palettes
+void bs_animateModel(bs_Model *model, bs_Anim *anim, float time, int max_depth, bs_mat4 *pose) {
+	bs_mat4 *nodes = pose;
+	for(int i = 0; i < model->mesh_count; i++) {
+		nodes += model->meshes[i].joint_count;
+	}
+
+	bs_animateNodes(model, anim, time, nodes);
+
+	for(int i = 0; i < model->mesh_count; i++) {
+		bs_Mesh *mesh = &model->meshes[i];
+		bs_animateDepth(mesh, anim, time, max_depth, pose);
+
+		for(int j = 0; mesh->node >= 0 && j < mesh->joint_count; j++) {
+			glm_mul(nodes[mesh->node], pose[j], pose[j]);
+		}
+
+		pose += mesh->joint_count;
+	}
+}
+
+void bs_animateInstance(bs_ModelInstance *instance) {
+	if(instance->anim == NULL)
+		return;
+
+	bs_animateModel(instance->model, instance->anim, bs_wrapAnimTime(instance->anim, instance->time), INT_MAX, instance->pose);
+
+	if(instance->weight_count > 0)
+		bs_sampleWeights(instance->model, instance->anim, bs_wrapAnimTime(instance->anim, instance->time), instance->weights);
+}
+
+/* --- LOD --- */
+// Update rate and deepest animated joint of every level, the lower levels only lose fingers and the like
+float anim_lod_rates[BS_ANIM_LOD_COUNT] = { 60.0, 30.0, 15.0, 7.5 };
+int anim_lod_depths[BS_ANIM_LOD_COUNT] = { INT_MAX, INT_MAX, 4, 2 };
+// Smallest fraction of the screen height covered by each level
+float anim_lod_sizes[BS_ANIM_LOD_COUNT - 1] = { 0.25, 0.1, 0.03 };
+
+// screen_size is the projected height of the instance over the viewport height
+void bs_setAnimLod(bs_ModelInstance *instance, float screen_size) {
+	int lod = 0;
+	while(lod < BS_ANIM_LOD_COUNT - 1 && screen_size < anim_lod_sizes[lod]) {
+		lod++;
+	}
+
+	instance->lod = lod;
+}
+
+/* --- SHARED POSES --- */
+// Instances playing the same clip of the same model at the same quantized time share one evaluation
+typedef struct {
+	bs_Model *model;
+	bs_Anim *anim;
+	int frame;
+	int lod;
+} bs_PoseKey;
+
+typedef struct {
+	bs_PoseKey key;
+	bs_mat4 *pose;
+
+	bool used;
+	bool ready;
+} bs_SharedPose;
+
+bs_SharedPose *shared_poses = NULL;
+int shared_pose_count = 0;
+int shared_pose_capacity = 0;
+
+// Open addressing over shared_poses, rebuilt for every bs_animateInstances
+typedef struct {
+	int *slots;
+	int mask;
+} bs_PoseTable;
+
+int bs_findSharedPose(bs_PoseTable *table, bs_PoseKey *key, int pose_count) {
+	uint64_t hash = bs_hash64(key, sizeof(bs_PoseKey), 0);
+	int slot = hash & table->mask;
+
+	for(;; slot = (slot + 1) & table->mask) {
+		int index = table->slots[slot];
+		if(index == -1)
+			break;
+
+		if(memcmp(&shared_poses[index].key, key, sizeof(bs_PoseKey)) == 0) {
+			shared_poses[index].used = true;
+			return index;
+		}
+	}
+
+	if(shared_pose_count == shared_pose_capacity) {
+		shared_pose_capacity = BS_MAX(shared_pose_capacity * 2, 64);
+		shared_poses = realloc(shared_poses, shared_pose_capacity * sizeof(bs_SharedPose));
+	}
+
+	int index = shared_pose_count++;
+	shared_poses[index] = (bs_SharedPose){ *key, malloc(pose_count * sizeof(bs_mat4)), true, false };
+	table->slots[slot] = index;
+
+	return index;
+}
+
+// Drops every shared pose of the model, called when the model is freed
+void bs_releasePoses(bs_Model *model) {
+	int count = 0;
+
+	for(int i = 0; i < shared_pose_count; i++) {
+		if(shared_poses[i].key.model == model)
+			free(shared_poses[i].pose);
+		else
+			shared_poses[count++] = shared_poses[i];
+	}
+
+	shared_pose_count = count;
+}
+
+void bs_evaluateSharedPose(int index, void *arg) {
+	int *pending = arg;
+	bs_SharedPose *shared = &shared_poses[pending[index]];
+	bs_Model *model = shared->key.model;
+
+	// The frame after the end of the clip holds the last key so instances don't blend into the start
+	float time = BS_MIN(shared->key.frame / anim_lod_rates[shared->key.lod], shared->key.anim->duration);
+	int max_depth = anim_lod_depths[shared->key.lod];
+
+	bs_animateModel(model, shared->key.anim, time, max_depth, shared->pose);
+}
+
+/* --- INSTANCES --- */
+// The two shared poses around an instance's time
+typedef struct {
+	int from, to;
+	float blend;
+} bs_PoseBlend;
+
+typedef struct {
+	bs_ModelInstance *instances;
+	int instance_count;
+	bs_PoseBlend *blends;
+} bs_PoseBatch;
+
+// A plain lerp of the skin matrices, the keys are at most a few frames apart
+void bs_blendInstanceJob(int index, void *arg) {
+	bs_PoseBatch *batch = arg;
+	int end = BS_MIN((index + 1) * BS_POSE_BATCH_SIZE, batch->instance_count);
+
+	for(int i = index * BS_POSE_BATCH_SIZE; i < end; i++) {
+		bs_ModelInstance *instance = &batch->instances[i];
+		bs_PoseBlend *blend = &batch->blends[i];
+
+		// Weights are few, they're sampled per instance at the exact time
+		if(instance->anim != NULL && instance->weight_count > 0)
+			bs_sampleWeights(instance->model, instance->anim, bs_wrapAnimTime(instance->anim, instance->time), instance->weights);
+
+		if(blend->from == -1)
+			continue;
+
+		float *from = (float *)shared_poses[blend->from].pose;
+		float *to = (float *)shared_poses[blend->to].pose;
+		float *out = (float *)instance->pose;
+
+		for(int j = 0; j < instance->pose_count * 16; j++) {
+			out[j] = from[j] + (to[j] - from[j]) * blend->blend;
+		}
+	}
+}
+
+// Instances are posed at their LOD's update rate from poses shared by every instance in sync,
+// so the evaluation cost follows the number of distinct (model, clip, frame, lod) and not the crowd size.
+// Shared poses nobody used this call are dropped. The palettes are ready for bs_pushPalette afterwards,
+// bs_animateInstance still evaluates one instance exactly
+void bs_animateInstances(bs_ModelInstance *instances, int instance_count) {
+	bs_PoseBlend *blends = malloc(instance_count * sizeof(bs_PoseBlend));
+
+	// Every instance adds at most two poses, the table stays at most half full
+	int table_size = 16;
+	while(table_size < (shared_pose_count + instance_count * 2) * 2) {
+		table_size *= 2;
+	}
+
+	bs_PoseTable table = { malloc(table_size * sizeof(int)), table_size - 1 };
+	memset(table.slots, -1, table_size * sizeof(int));
+
+	for(int i = 0; i < shared_pose_count; i++) {
+		shared_poses[i].used = false;
+
+		uint64_t hash = bs_hash64(&shared_poses[i].key, sizeof(bs_PoseKey), 0);
+		int slot = hash & table.mask;
+		while(table.slots[slot] != -1) {
+			slot = (slot + 1) & table.mask;
+		}
+
+		table.slots[slot] = i;
+	}
+
+	for(int i = 0; i < instance_count; i++) {
+		bs_ModelInstance *instance = &instances[i];
+		blends[i].from = -1;
+
+		if(instance->anim == NULL || instance->pose_count == 0)
+			continue;
+
+		bs_Anim *anim = instance->anim;
+		int lod = BS_MIN(BS_MAX(instance->lod, 0), BS_ANIM_LOD_COUNT - 1);
+
+		float frame = bs_wrapAnimTime(anim, instance->time) * anim_lod_rates[lod];
+		bs_PoseKey key;
+		memset(&key, 0, sizeof(bs_PoseKey));
+		key.model = instance->model;
+		key.anim = anim;
+		key.frame = (int)frame;
+		key.lod = lod;
+
+		blends[i].from = bs_findSharedPose(&table, &key, instance->pose_count);
+		blends[i].blend = frame - key.frame;
+
+		key.frame++;
+		blends[i].to = blends[i].blend > 0.0 ? bs_findSharedPose(&table, &key, instance->pose_count) : blends[i].from;
+	}
+
+	// Poses carried over from the last call are still valid
+	int *pending = malloc(shared_pose_count * sizeof(int));
+	int pending_count = 0;
+
+	for(int i = 0; i < shared_pose_count; i++) {
+		if(!shared_poses[i].ready) {
+			pending[pending_count++] = i;
+			shared_poses[i].ready = true;
+		}
+	}
+
+	bs_parallelFor(pending_count, bs_evaluateSharedPose, pending);
+
+	bs_PoseBatch batch = { instances, instance_count, blends };
+	bs_parallelFor((instance_count + BS_POSE_BATCH_SIZE - 1) / BS_POSE_BATCH_SIZE, bs_blendInstanceJob, &batch);
+
+	int count = 0;
+	for(int i = 0; i < shared_pose_count; i++) {
+		if(shared_poses[i].used)
+			shared_poses[count++] = shared_poses[i];
+		else
+			free(shared_poses[i].pose);
+	}
+
+	shared_pose_count = count;
+
+	free(pending);
+	free(table.slots);
+	free(blends);
+}
\ No newline at end of file
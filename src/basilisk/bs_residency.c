@@ -0,0 +1,163 @@
+// GL
+#include <glad/glad.h>
+
+// Basilisk
+#include <bs_textures.h>
+#include <bs_residency.h>
+
+// STD
+#include <stdlib.h>
+#include <stdbool.h>
+
+size_t texture_budget = 0;
+int residency_frame = 1;
+
+size_t bs_getAtlasGPUBytes(bs_Atlas *atlas) {
+    if(atlas->resident_level < 0)
+        return 0;
+
+    return bs_getAtlasLevelBytes(atlas, atlas->resident_level);
+}
+
+size_t bs_getAtlasCPUBytes(bs_Atlas *atlas) {
+    size_t bytes = 0;
+
+    if(atlas->data != NULL)
+        bytes += (size_t)atlas->w * atlas->h * 4;
+    if(atlas->baked != NULL)
+        bytes += atlas->baked_size;
+
+    return bytes;
+}
+
+// Bytes taken by the texture in its atlas, including its share of the mip chain
+size_t bs_getTextureBytes(bs_Tex2D *tex) {
+    bs_Atlas *atlas = bs_getAtlas(tex->atlas_id);
+    size_t full = bs_getFormatSize(atlas->format, tex->w, tex->h);
+
+    return full + full / 3;
+}
+
+// Atlases with uploads in flight are left alone
+void bs_evictAtlas(bs_Atlas *atlas) {
+    glDeleteTextures(1, &atlas->tex_id);
+    atlas->tex_id = 0;
+    atlas->resident_level = -1;
+}
+
+// Streams in the mip chain starting at level, the old GPU copy is kept until it's done
+bool bs_restoreAtlas(bs_Atlas *atlas, int level) {
+    if(atlas->pending_level != -1)
+        return true;
+
+    unsigned char *levels = bs_readAtlasLevels(atlas, level);
+    if(levels == NULL)
+        return false;
+
+    bs_streamAtlasLevels(atlas, levels, level);
+    return true;
+}
+
+void bs_setTextureBudget(size_t bytes) {
+    texture_budget = bytes;
+}
+
+// Runs on every draw, so it only records the use, the cache is read in bs_updateResidency
+void bs_markAtlasUsed(bs_Atlas *atlas) {
+    atlas->last_used = residency_frame;
+
+    if(atlas->resident_level != 0 && atlas->pending_level == -1 && !atlas->restore_failed)
+        atlas->restore_requested = true;
+}
+
+void bs_markTextureUsed(bs_Tex2D *tex) {
+    tex->last_used = residency_frame;
+    bs_markAtlasUsed(bs_getAtlas(tex->atlas_id));
+}
+
+// Drops least recently used atlases until the GPU bytes fit the budget
+// Atlases used during the last frame are never touched
+void bs_updateResidency() {
+    // Streams back atlases drawn last frame, their uploads start with the next bs_processUploads
+    for(int i = 0; i < bs_getAtlasCount(); i++) {
+        bs_Atlas *atlas = bs_getAtlas(i);
+        if(!atlas->restore_requested)
+            continue;
+
+        atlas->restore_requested = false;
+        if(!bs_restoreAtlas(atlas, 0))
+            atlas->restore_failed = true;
+    }
+
+    residency_frame++;
+
+    if(texture_budget == 0)
+        return;
+
+    size_t total = 0;
+    for(int i = 0; i < bs_getAtlasCount(); i++) {
+        total += bs_getAtlasGPUBytes(bs_getAtlas(i));
+    }
+
+    while(total > texture_budget) {
+        bs_Atlas *lru = NULL;
+
+        for(int i = 0; i < bs_getAtlasCount(); i++) {
+            bs_Atlas *atlas = bs_getAtlas(i);
+
+            if(atlas->resident_level < 0 || atlas->cache_path == NULL || atlas->pending_level != -1)
+                continue;
+            if(atlas->last_used >= residency_frame - 1)
+                continue;
+
+            if(lru == NULL || atlas->last_used < lru->last_used)
+                lru = atlas;
+        }
+
+        if(lru == NULL)
+            break;
+
+        total -= bs_getAtlasGPUBytes(lru);
+
+        bool evict = (residency_frame - lru->last_used) > BS_EVICT_AGE ||
+            lru->resident_level >= BS_MAX_DOWNGRADE ||
+            lru->resident_level + 1 >= lru->level_count;
+
+        if(!evict && !bs_restoreAtlas(lru, lru->resident_level + 1)) {
+            lru->restore_failed = true;
+            evict = true;
+        }
+
+        if(evict)
+            bs_evictAtlas(lru);
+
+        // Downgrades count at their new size right away
+        if(lru->pending_level != -1) {
+            total += bs_getAtlasLevelBytes(lru, lru->pending_level);
+        } else {
+            total += bs_getAtlasGPUBytes(lru);
+        }
+    }
+}
+
+bs_ResidencyStats bs_getResidencyStats() {
+    bs_ResidencyStats stats = { texture_budget, 0, 0, 0, 0, 0, 0 };
+
+    for(int i = 0; i < bs_getAtlasCount(); i++) {
+        bs_Atlas *atlas = bs_getAtlas(i);
+
+        stats.gpu_bytes += bs_getAtlasGPUBytes(atlas);
+        stats.cpu_bytes += bs_getAtlasCPUBytes(atlas);
+        stats.dedup_bytes_saved += atlas->dedup_bytes_saved;
+
+        if(atlas->resident_level < 0) {
+            stats.evicted_count++;
+        } else if(atlas->resident_level > 0) {
+            stats.downgraded_count++;
+        } else {
+            stats.resident_count++;
+        }
+    }
+
+    return stats;
+}
\ No newline at end of file
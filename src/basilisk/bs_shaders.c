@@ -16,7 +16,7 @@
 #include <stdlib.h>
 
 int loaded_shader_count = 0;
-const char *std_uniforms[] = { "bs_Proj", "bs_View", "bs_Time" };
+const char *std_uniforms[] = { "bs_Proj", "bs_View", "bs_Time", "bs_Joints", "bs_JointPalette", "bs_JointOffset", "bs_MorphDeltas", "bs_MorphWeights" };
 
 // INITIALIZATION
 // Gets all default uniform locations
@@ -101,6 +101,7 @@ void bs_loadMemShader(char *vs_code, char *fs_code, char *gs_code, bs_Shader *sh
     glAttachShader(shader->id, shader->fs_id);
 
     // Geometry shader is not mandatory
+    shader->gs_id = 0;
     if(gs_code != 0) {
         bs_loadShaderCode(&shader->gs_id, gs_code, GL_GEOMETRY_SHADER);
         glAttachShader(shader->id, shader->gs_id);
@@ -141,6 +142,60 @@ void bs_loadShader(char *vs_path, char *fs_path, char *gs_path, bs_Shader *shade
     bs_loadMemShader(vscode, fscode, gscode, shader);
 }
 
+// Vertex only program whose outputs are captured with transform feedback, varyings are interleaved in the given order
+void bs_loadMemFeedbackShader(char *vs_code, const char **varyings, int varying_count, bs_Shader *shader) {
+    if(vs_code == NULL) {
+        shader->id = -1;
+        return;
+    }
+
+    shader->id = glCreateProgram();
+    shader->fs_id = 0;
+    shader->gs_id = 0;
+
+    bs_loadShaderCode(&shader->vs_id, vs_code, GL_VERTEX_SHADER);
+    glAttachShader(shader->id, shader->vs_id);
+
+    // Has to be set before linking
+    glTransformFeedbackVaryings(shader->id, varying_count, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(shader->id);
+    glUseProgram(shader->id);
+
+    for(int i = 0; i < UNIFORM_TYPE_COUNT; i++) {
+        shader->uniforms[i].is_valid = false;
+    }
+    bs_setDefaultUniforms(shader, vs_code);
+
+    shader->index = loaded_shader_count;
+    loaded_shader_count++;
+}
+
+void bs_loadFeedbackShader(char *vs_path, const char **varyings, int varying_count, bs_Shader *shader) {
+    int vs_err_code;
+    char *vscode = bs_readFileToString(vs_path, &vs_err_code);
+
+    if(vs_err_code == 2) {
+        shader->id = -1;
+        return;
+    }
+
+    bs_loadMemFeedbackShader(vscode, varyings, varying_count, shader);
+}
+
+void bs_freeShader(bs_Shader *shader) {
+    if(shader->id == -1)
+        return;
+
+    glDeleteProgram(shader->id);
+    glDeleteShader(shader->vs_id);
+
+    if(shader->fs_id != 0)
+        glDeleteShader(shader->fs_id);
+
+    if(shader->gs_id != 0)
+        glDeleteShader(shader->gs_id);
+}
+
 int bs_getUniformLoc(bs_Shader *shader, char *name) {
     return glGetUniformLocation(shader->id, name);
 }
@@ -182,6 +237,102 @@ void bs_setProjMatrixUniform(bs_Shader *shader, void *cam) {
     bs_uniform_mat4(uniform->loc, ((bs_Camera*)cam)->proj);
 }
 
+// Whole skeleton in one call, the shader declares "uniform mat4 bs_Joints[n]"
+void bs_setJointsUniform(bs_Shader *shader, float (*pose)[4][4], int count) {
+    bs_Uniform *uniform = &shader->uniforms[UNIFORM_JOINTS];
+
+    if(!uniform->is_valid || count == 0)
+        return;
+
+    bs_uniform_mat4_array(uniform->loc, pose, count);
+}
+
+// Offset returned by bs_pushPalette for the mesh that is drawn next
+void bs_setJointOffsetUniform(bs_Shader *shader, int offset) {
+    bs_Uniform *uniform = &shader->uniforms[UNIFORM_JOINT_OFFSET];
+
+    if(!uniform->is_valid)
+        return;
+
+    bs_uniform_int(uniform->loc, offset);
+}
+
+void bs_setPaletteUniform(bs_Shader *shader, bs_PaletteBuffer *palettes, int unit) {
+    bs_Uniform *uniform = &shader->uniforms[UNIFORM_JOINT_PALETTE];
+
+    if(!uniform->is_valid)
+        return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, palettes->texture);
+    bs_uniform_int(uniform->loc, unit);
+
+    // bs_selectAtlas binds on the active unit
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// JOINT PALETTES
+// For skeletons too large for a uniform array and for sharing one buffer between instances
+void bs_createPaletteBuffer(bs_PaletteBuffer *palettes) {
+    glGenBuffers(1, &palettes->buffer);
+    glGenTextures(1, &palettes->texture);
+
+    palettes->data = NULL;
+    palettes->count = 0;
+    palettes->capacity = 0;
+    palettes->buffer_capacity = 0;
+}
+
+void bs_freePaletteBuffer(bs_PaletteBuffer *palettes) {
+    glDeleteTextures(1, &palettes->texture);
+    glDeleteBuffers(1, &palettes->buffer);
+    free(palettes->data);
+
+    palettes->data = NULL;
+    palettes->count = palettes->capacity = palettes->buffer_capacity = 0;
+}
+
+// Called at the start of every frame before the palettes are pushed again
+void bs_clearPalettes(bs_PaletteBuffer *palettes) {
+    palettes->count = 0;
+}
+
+// Returns the offset of the palette in matrices
+int bs_pushPalette(bs_PaletteBuffer *palettes, float (*pose)[4][4], int count) {
+    if(palettes->count + count > palettes->capacity) {
+        palettes->capacity = palettes->capacity == 0 ? 256 : palettes->capacity;
+        while(palettes->count + count > palettes->capacity)
+            palettes->capacity *= 2;
+
+        palettes->data = realloc(palettes->data, palettes->capacity * sizeof(*palettes->data));
+    }
+
+    int offset = palettes->count;
+    memcpy(palettes->data + offset, pose, count * sizeof(*palettes->data));
+    palettes->count += count;
+
+    return offset;
+}
+
+// Sends every palette pushed this frame in one call
+void bs_uploadPalettes(bs_PaletteBuffer *palettes) {
+    if(palettes->count == 0)
+        return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, palettes->buffer);
+
+    // Storage is reallocated (and the texture rebound to it) only when the palettes outgrow it
+    if(palettes->capacity > palettes->buffer_capacity) {
+        glBufferData(GL_TEXTURE_BUFFER, palettes->capacity * sizeof(*palettes->data), NULL, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, palettes->texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, palettes->buffer);
+        palettes->buffer_capacity = palettes->capacity;
+    }
+
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, palettes->count * sizeof(*palettes->data), palettes->data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
 // SHADER ABSTRACTION LAYER
 void bs_switchShader(bs_Shader *shader) {
     glUseProgram(shader->id);
@@ -193,12 +344,20 @@ void bs_uniform_mat4(int loc, float mat[4][4]) {
     glUniformMatrix4fv(loc, 1, GL_FALSE, mat[0]);
 }
 
+void bs_uniform_mat4_array(int loc, float (*mats)[4][4], int count) {
+    glUniformMatrix4fv(loc, count, GL_FALSE, mats[0][0]);
+}
+
 // SCALARS
 // TODO: bool, int, uint, double
 void bs_uniform_float(int loc, float val) {
     glUniform1f(loc, val);
 }
 
+void bs_uniform_int(int loc, int val) {
+    glUniform1i(loc, val);
+}
+
 // VECTORS
 // TODO: bvecn, ivecn, uvecn, vecn, dvecn
 
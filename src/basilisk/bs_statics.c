@@ -0,0 +1,367 @@
+// GL
+#include <glad/glad.h>
+#include <cglm/cglm.h>
+
+// Basilisk
+#include <bs_statics.h>
+#include <bs_core.h>
+#include <bs_shaders.h>
+#include <bs_textures.h>
+#include <bs_residency.h>
+#include <bs_models.h>
+
+// STD
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+typedef struct {
+    int cell[3];
+    int triangle;
+} bs_StaticCell;
+
+// Meshes that never move relative to their model, skinned, morphed and node animated meshes stay dynamic
+bool bs_isStaticMesh(bs_Mesh *mesh) {
+    return mesh->joint_count == 0 && mesh->node == -1 && mesh->target_count == 0;
+}
+
+void bs_createStaticLevel(bs_StaticLevel *level, float chunk_size) {
+    level->chunk_size = chunk_size;
+    level->placements = NULL;
+    level->placement_count = 0;
+    level->placement_capacity = 0;
+    level->groups = NULL;
+    level->group_count = 0;
+    level->drawn_ranges = 0;
+}
+
+void bs_pushStaticModel(bs_StaticLevel *level, bs_Model *model, bs_mat4 matrix, bs_Shader *shader) {
+    if(level->placement_count == level->placement_capacity) {
+        level->placement_capacity = level->placement_capacity == 0 ? 64 : level->placement_capacity * 2;
+        level->placements = realloc(level->placements, level->placement_capacity * sizeof(bs_StaticPlacement));
+    }
+
+    bs_StaticPlacement *placement = &level->placements[level->placement_count++];
+    placement->model = model;
+    placement->shader = shader;
+    glm_mat4_copy(matrix, placement->matrix);
+}
+
+/* --- MERGING --- */
+// Untextured prims use the white texel of the std atlas like bs_pushPrim, so they join its group
+bs_StaticGroup *bs_getStaticGroup(bs_StaticLevel *level, bs_Shader *shader, bs_Tex2D *tex) {
+    int atlas_id = tex != NULL ? tex->atlas_id : bs_getStdAtlas()->id;
+
+    bs_StaticGroup *group = NULL;
+    for(int i = 0; i < level->group_count && group == NULL; i++) {
+        if(level->groups[i].shader == shader && level->groups[i].atlas_id == atlas_id)
+            group = &level->groups[i];
+    }
+
+    if(group == NULL) {
+        level->groups = realloc(level->groups, (level->group_count + 1) * sizeof(bs_StaticGroup));
+        group = &level->groups[level->group_count++];
+        memset(group, 0, sizeof(bs_StaticGroup));
+        group->shader = shader;
+        group->atlas_id = atlas_id;
+    }
+
+    if(tex == NULL)
+        return group;
+
+    for(int i = 0; i < group->texture_count; i++) {
+        if(group->textures[i] == tex)
+            return group;
+    }
+
+    group->textures = realloc(group->textures, (group->texture_count + 1) * sizeof(bs_Tex2D *));
+    group->textures[group->texture_count++] = tex;
+    return group;
+}
+
+void bs_reserveStaticGroup(bs_StaticGroup *group, int vertex_count, int index_count) {
+    if(group->vertex_count + vertex_count > group->vertex_capacity) {
+        group->vertex_capacity = group->vertex_capacity * 2 > group->vertex_count + vertex_count ? group->vertex_capacity * 2 : group->vertex_count + vertex_count;
+        group->vertices = realloc(group->vertices, group->vertex_capacity * sizeof(bs_Vertex));
+    }
+
+    if(group->index_count + index_count > group->index_capacity) {
+        group->index_capacity = group->index_capacity * 2 > group->index_count + index_count ? group->index_capacity * 2 : group->index_count + index_count;
+        group->indices = realloc(group->indices, group->index_capacity * sizeof(int));
+    }
+}
+
+// Same vertex as bs_pushPrim writes into a batch, only moved into world space
+void bs_mergeStaticPrim(bs_StaticGroup *group, bs_Prim *prim, bs_mat4 matrix, bs_mat4 normal_matrix, bool flip) {
+    bs_reserveStaticGroup(group, prim->vertex_count, prim->index_count);
+
+    for(int i = 0; i + 2 < prim->index_count; i += 3) {
+        int *dst = &group->indices[group->index_count + i];
+        dst[0] = prim->indices[i + 0] + group->vertex_count;
+        dst[1] = prim->indices[i + (flip ? 2 : 1)] + group->vertex_count;
+        dst[2] = prim->indices[i + (flip ? 1 : 2)] + group->vertex_count;
+    }
+
+    for(int i = 0; i < prim->vertex_count; i++) {
+        bs_RVertex *src = &prim->vertices[i];
+        bs_Vertex *vertex = &group->vertices[group->vertex_count + i];
+
+        glm_mat4_mulv3(matrix, (float *)&src->position, 1.0, (float *)&vertex->position);
+        glm_mat4_mulv3(normal_matrix, (float *)&src->normal, 0.0, (float *)&vertex->normal);
+        glm_vec3_normalize((float *)&vertex->normal);
+        vertex->color = prim->material.base_color;
+
+        const float white_tex_coord = 0.9999;
+        vertex->tex_coord = (bs_vec2){ white_tex_coord, white_tex_coord };
+
+        if(prim->material.tex != NULL) {
+            bs_Tex2D *tex = prim->material.tex;
+            vertex->tex_coord.x = tex->tex_x + src->tex_coord.x * (tex->tex_wx - tex->tex_x);
+            vertex->tex_coord.y = tex->tex_y + src->tex_coord.y * (tex->tex_hy - tex->tex_y);
+        }
+    }
+
+    group->vertex_count += prim->vertex_count;
+    group->index_count += prim->index_count - prim->index_count % 3;
+}
+
+int bs_compareStaticCells(const void *a, const void *b) {
+    const bs_StaticCell *cell_a = a, *cell_b = b;
+
+    for(int i = 0; i < 3; i++) {
+        if(cell_a->cell[i] != cell_b->cell[i])
+            return cell_a->cell[i] < cell_b->cell[i] ? -1 : 1;
+    }
+
+    return cell_a->triangle - cell_b->triangle;
+}
+
+// Sorts the triangles by the cell their centroid falls in, every run of one cell becomes a chunk
+void bs_chunkStaticGroup(bs_StaticGroup *group, float chunk_size) {
+    int triangle_count = group->index_count / 3;
+    bs_StaticCell *cells = malloc(triangle_count * sizeof(bs_StaticCell));
+
+    for(int i = 0; i < triangle_count; i++) {
+        vec3 centroid = { 0.0, 0.0, 0.0 };
+        for(int j = 0; j < 3; j++) {
+            glm_vec3_add(centroid, (float *)&group->vertices[group->indices[i * 3 + j]].position, centroid);
+        }
+        glm_vec3_divs(centroid, 3.0, centroid);
+
+        cells[i].triangle = i;
+        for(int j = 0; j < 3; j++) {
+            cells[i].cell[j] = chunk_size > 0.0 ? (int)floorf(centroid[j] / chunk_size) : 0;
+        }
+    }
+
+    qsort(cells, triangle_count, sizeof(bs_StaticCell), bs_compareStaticCells);
+
+    int *indices = malloc(group->index_count * sizeof(int));
+    group->chunks = malloc(triangle_count * sizeof(bs_StaticChunk));
+    group->chunk_count = 0;
+
+    for(int i = 0; i < triangle_count; i++) {
+        bool new_chunk = i == 0 || memcmp(cells[i].cell, cells[i - 1].cell, sizeof(cells[i].cell)) != 0;
+        bs_StaticChunk *chunk = &group->chunks[new_chunk ? group->chunk_count++ : group->chunk_count - 1];
+
+        if(new_chunk) {
+            chunk->min = (bs_vec3){ INFINITY, INFINITY, INFINITY };
+            chunk->max = (bs_vec3){ -INFINITY, -INFINITY, -INFINITY };
+            chunk->index_offset = i * 3;
+            chunk->index_count = 0;
+        }
+
+        for(int j = 0; j < 3; j++) {
+            int index = group->indices[cells[i].triangle * 3 + j];
+            indices[i * 3 + j] = index;
+            glm_vec3_minv((float *)&chunk->min, (float *)&group->vertices[index].position, (float *)&chunk->min);
+            glm_vec3_maxv((float *)&chunk->max, (float *)&group->vertices[index].position, (float *)&chunk->max);
+        }
+
+        chunk->index_count += 3;
+    }
+
+    free(group->indices);
+    free(cells);
+    group->indices = indices;
+    group->index_capacity = group->index_count;
+    // Every chunk can end up as its own range when the visible ones aren't neighbours
+    int range_capacity = group->chunk_count > 0 ? group->chunk_count : 1;
+    group->range_counts = malloc(range_capacity * sizeof(int));
+    group->range_offsets = malloc(range_capacity * sizeof(void *));
+}
+
+// Builds the CPU side of every group, the placements are consumed
+// Returns false without merging anything if a texture isn't in its atlas yet
+bool bs_mergeStaticLevel(bs_StaticLevel *level) {
+    for(int i = 0; i < level->placement_count; i++) {
+        if(!bs_areModelTexturesPacked(level->placements[i].model)) {
+            printf("Static level has to be built after its atlases are pushed\n");
+            return false;
+        }
+    }
+
+    for(int i = 0; i < level->placement_count; i++) {
+        bs_StaticPlacement *placement = &level->placements[i];
+        bs_Model *model = placement->model;
+
+        bs_mat4 normal_matrix;
+        glm_mat4_inv(placement->matrix, normal_matrix);
+        glm_mat4_transpose(normal_matrix);
+        bool flip = glm_mat4_det(placement->matrix) < 0.0;
+
+        for(int j = 0; j < model->mesh_count; j++) {
+            bs_Mesh *mesh = &model->meshes[j];
+            if(!bs_isStaticMesh(mesh))
+                continue;
+
+            for(int k = 0; k < mesh->prim_count; k++) {
+                bs_Prim *prim = &mesh->prims[k];
+                bs_StaticGroup *group = bs_getStaticGroup(level, placement->shader, prim->material.tex);
+                bs_mergeStaticPrim(group, prim, placement->matrix, normal_matrix, flip);
+            }
+        }
+    }
+
+    for(int i = 0; i < level->group_count; i++) {
+        bs_chunkStaticGroup(&level->groups[i], level->chunk_size);
+    }
+
+    free(level->placements);
+    level->placements = NULL;
+    level->placement_count = level->placement_capacity = 0;
+    return true;
+}
+
+// Merges the pushed models and uploads one vertex and index buffer per group
+bool bs_buildStaticLevel(bs_StaticLevel *level) {
+    if(!bs_mergeStaticLevel(level))
+        return false;
+
+    for(int i = 0; i < level->group_count; i++) {
+        bs_StaticGroup *group = &level->groups[i];
+
+        glGenVertexArrays(1, &group->VAO);
+        glGenBuffers(1, &group->VBO);
+        glGenBuffers(1, &group->EBO);
+
+        glBindVertexArray(group->VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, group->VBO);
+        glBufferData(GL_ARRAY_BUFFER, group->vertex_count * sizeof(bs_Vertex), group->vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group->EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, group->index_count * sizeof(int), group->indices, GL_STATIC_DRAW);
+
+        // Texture batch layout
+        for(int j = 0; j < 4; j++) {
+            glEnableVertexAttribArray(j);
+        }
+
+        glVertexAttribPointer(0, 3, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, position));
+        glVertexAttribPointer(1, 2, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, tex_coord));
+        glVertexAttribPointer(2, 3, BS_FLOAT, false, sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, normal));
+        glVertexAttribPointer(3, 4, BS_UBYTE, true , sizeof(bs_Vertex), (void*)offsetof(bs_Vertex, color));
+
+        glBindVertexArray(0);
+
+        free(group->vertices);
+        free(group->indices);
+        group->vertices = NULL;
+        group->indices = NULL;
+        group->vertex_capacity = group->index_capacity = 0;
+    }
+
+    return true;
+}
+
+void bs_freeStaticLevel(bs_StaticLevel *level) {
+    for(int i = 0; i < level->group_count; i++) {
+        bs_StaticGroup *group = &level->groups[i];
+
+        if(group->VAO != 0) {
+            glDeleteVertexArrays(1, &group->VAO);
+            glDeleteBuffers(1, &group->VBO);
+            glDeleteBuffers(1, &group->EBO);
+        }
+
+        free(group->vertices);
+        free(group->indices);
+        free(group->chunks);
+        free(group->textures);
+        free(group->range_counts);
+        free(group->range_offsets);
+    }
+
+    free(level->groups);
+    free(level->placements);
+    bs_createStaticLevel(level, level->chunk_size);
+}
+
+/* --- RENDERING --- */
+// Fills the draw ranges with the chunks inside the frustum and returns how many there are
+int bs_cullStaticGroup(bs_StaticGroup *group, vec4 planes[6]) {
+    int range_count = 0;
+    int range_end = -1;
+
+    for(int i = 0; i < group->chunk_count; i++) {
+        bs_StaticChunk *chunk = &group->chunks[i];
+
+        vec3 box[2];
+        glm_vec3_copy((float *)&chunk->min, box[0]);
+        glm_vec3_copy((float *)&chunk->max, box[1]);
+        if(!glm_aabb_frustum(box, planes))
+            continue;
+
+        if(chunk->index_offset == range_end) {
+            group->range_counts[range_count - 1] += chunk->index_count;
+        } else {
+            group->range_counts[range_count] = chunk->index_count;
+            group->range_offsets[range_count] = (void *)(chunk->index_offset * sizeof(GLuint));
+            range_count++;
+        }
+
+        range_end = chunk->index_offset + chunk->index_count;
+    }
+
+    return range_count;
+}
+
+void bs_renderStaticLevel(bs_StaticLevel *level, bs_Camera *camera) {
+    bs_mat4 view_proj;
+    vec4 planes[6];
+    glm_mat4_mul(camera->proj, camera->view, view_proj);
+    glm_frustum_planes(view_proj, planes);
+
+    level->drawn_ranges = 0;
+    bool std_atlas_bound = true;
+
+    for(int i = 0; i < level->group_count; i++) {
+        bs_StaticGroup *group = &level->groups[i];
+
+        int range_count = bs_cullStaticGroup(group, planes);
+        if(range_count == 0)
+            continue;
+
+        for(int j = 0; j < group->texture_count; j++) {
+            bs_markTextureUsed(group->textures[j]);
+        }
+
+        bs_selectAtlas(bs_getAtlas(group->atlas_id));
+        std_atlas_bound = group->atlas_id == bs_getStdAtlas()->id;
+
+        bs_switchShader(group->shader);
+        bs_setViewMatrixUniform(group->shader, camera);
+        bs_setProjMatrixUniform(group->shader, camera);
+
+        glBindVertexArray(group->VAO);
+        glMultiDrawElements(BS_TRIANGLES, group->range_counts, GL_UNSIGNED_INT, (const void *const *)group->range_offsets, range_count);
+        level->drawn_ranges += range_count;
+    }
+
+    glBindVertexArray(0);
+
+    // Batches drawn after the level expect the std atlas
+    if(!std_atlas_bound)
+        bs_selectAtlas(bs_getStdAtlas());
+}
\ No newline at end of file
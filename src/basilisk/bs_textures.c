@@ -7,6 +7,10 @@
 #include <bs_shaders.h>
 #include <bs_core.h>
 #include <bs_textures.h>
+#include <bs_math.h>
+#include <bs_jobs.h>
+#include <bs_residency.h>
+#include <bs_uploads.h>
 
 #include <lodepng.h>
 #include <cappend.h>
@@ -15,72 +19,633 @@
 // STD
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <windows.h>
 
+// S3TC isn't part of core GL, values from EXT_texture_compression_s3tc
+#define BS_COMPRESSED_RGBA_S3TC_DXT1 0x83F1
+#define BS_COMPRESSED_RGBA_S3TC_DXT5 0x83F3
+
+#define BS_ATLAS_CACHE_VERSION 1
+
+// Atlases start at this size and double until their textures fit
+#define BS_MIN_ATLAS_DIM 64
+#define BS_WHITE_SQUARE_DIM (BS_ATLAS_SIZE / 128)
+
+typedef struct {
+    char magic[4];
+    int version;
+    int w, h;
+    int format;
+    int level_count;
+    uint64_t hash;
+    uint64_t size;
+} bs_AtlasCacheHeader;
+
+typedef struct {
+    unsigned char *src;
+    unsigned char *dst;
+    int w, h;
+    int dst_w;
+    bs_TexFormat format;
+} bs_EncodeJob;
+
+const bs_TexFormatInfo tex_formats[BS_TEX_FORMAT_COUNT] = {
+    [BS_TEX_RGBA8]  = { GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE       , 1, 4  },
+    [BS_TEX_R8]     = { GL_R8  , GL_RED , GL_UNSIGNED_BYTE       , 1, 1  },
+    [BS_TEX_RG8]    = { GL_RG8 , GL_RG  , GL_UNSIGNED_BYTE       , 1, 2  },
+    [BS_TEX_RGB565] = { GL_RGB , GL_RGB , GL_UNSIGNED_SHORT_5_6_5, 1, 2  },
+    [BS_TEX_BC1]    = { BS_COMPRESSED_RGBA_S3TC_DXT1, 0, 0       , 4, 8  },
+    [BS_TEX_BC3]    = { BS_COMPRESSED_RGBA_S3TC_DXT5, 0, 0       , 4, 16 },
+};
+
 int atlas_count = 0;
-bs_Atlas *atlases;
+bs_Atlas **atlases;
 bs_Tex2D *curr_texture;
 
-void bs_splitTexture(unsigned char *data, int w, int h, int frames, int *curr_tex_count, bs_Tex2D **textures) {
+// Textures can be loaded from several threads, this guards adding them to the atlas
+pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* --- FORMAT ENCODING --- */
+int bs_getLevelDim(int dim, int level) {
+    return cappend_MAX(1, dim >> level);
+}
+
+const bs_TexFormatInfo *bs_getFormatInfo(bs_TexFormat format) {
+    return &tex_formats[format];
+}
+
+size_t bs_getFormatSize(bs_TexFormat format, int w, int h) {
+    const bs_TexFormatInfo *info = &tex_formats[format];
+    size_t blocks_x = (w + info->block_dim - 1) / info->block_dim;
+    size_t blocks_y = (h + info->block_dim - 1) / info->block_dim;
+
+    return blocks_x * blocks_y * info->block_bytes;
+}
+
+uint16_t bs_pack565(const int rgb[3]) {
+    return ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+}
+
+void bs_unpack565(uint16_t col, int rgb[3]) {
+    int r = (col >> 11) & 31;
+    int g = (col >> 5)  & 63;
+    int b =  col        & 31;
+
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Reads a 4x4 block, clamping to the edges of the image
+void bs_fetchBlock(unsigned char *src, int w, int h, int bx, int by, unsigned char block[16][4]) {
+    for(int y = 0; y < 4; y++) {
+        int sy = cappend_MIN(by * 4 + y, h - 1);
+
+        for(int x = 0; x < 4; x++) {
+            int sx = cappend_MIN(bx * 4 + x, w - 1);
+            memcpy(block[y * 4 + x], src + 4 * (sy * w + sx), 4);
+        }
+    }
+}
+
+// Range fit BC1 color block, punch-through alpha uses the 3 color mode
+void bs_encodeColorBlock(unsigned char block[16][4], unsigned char *out, bool allow_alpha) {
+    int min[3] = { 255, 255, 255 };
+    int max[3] = { 0, 0, 0 };
+    bool has_alpha = false;
+
+    for(int i = 0; i < 16; i++) {
+        if(allow_alpha && block[i][3] < 128) {
+            has_alpha = true;
+            continue;
+        }
+
+        for(int c = 0; c < 3; c++) {
+            min[c] = cappend_MIN(min[c], block[i][c]);
+            max[c] = cappend_MAX(max[c], block[i][c]);
+        }
+    }
+
+    // Completely transparent block
+    if(min[0] > max[0]) {
+        memset(out, 0, 4);
+        memset(out + 4, 0xFF, 4);
+        return;
+    }
+
+    // Inset the bounding box slightly, lowers the average error
+    for(int c = 0; c < 3; c++) {
+        int inset = (max[c] - min[c]) >> 4;
+        min[c] += inset;
+        max[c] -= inset;
+    }
+
+    uint16_t c0 = bs_pack565(max);
+    uint16_t c1 = bs_pack565(min);
+
+    // c0 > c1 selects 4 color mode, c0 <= c1 selects 3 colors + transparent
+    if(has_alpha ? (c0 > c1) : (c0 < c1)) {
+        uint16_t tmp = c0;
+        c0 = c1;
+        c1 = tmp;
+    }
+
+    int palette[4][3];
+    bs_unpack565(c0, palette[0]);
+    bs_unpack565(c1, palette[1]);
+
+    int palette_size = 4;
+    for(int c = 0; c < 3; c++) {
+        if(c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette_size = 3;
+        }
+    }
+
+    uint32_t indices = 0;
+    for(int i = 0; i < 16; i++) {
+        int best = 3;
+
+        if(!(has_alpha && block[i][3] < 128)) {
+            int best_dist = 0x7FFFFFFF;
+
+            for(int j = 0; j < palette_size; j++) {
+                int dr = block[i][0] - palette[j][0];
+                int dg = block[i][1] - palette[j][1];
+                int db = block[i][2] - palette[j][2];
+                int dist = dr * dr + dg * dg + db * db;
+
+                if(dist < best_dist) {
+                    best_dist = dist;
+                    best = j;
+                }
+            }
+        }
+
+        indices |= (uint32_t)best << (2 * i);
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for(int i = 0; i < 4; i++) {
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+// BC3 alpha block, always uses the 8 value interpolation mode
+void bs_encodeAlphaBlock(unsigned char block[16][4], unsigned char *out) {
+    int a0 = 0;
+    int a1 = 255;
+
+    for(int i = 0; i < 16; i++) {
+        a0 = cappend_MAX(a0, block[i][3]);
+        a1 = cappend_MIN(a1, block[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if(a0 > a1) {
+        int range = a0 - a1;
+
+        for(int i = 0; i < 16; i++) {
+            // t runs from 0 (a0) to 7 (a1), indices 2-7 are the in-between values
+            int t = ((a0 - block[i][3]) * 7 + range / 2) / range;
+            int index = (t == 0) ? 0 : (t == 7) ? 1 : t + 1;
+
+            indices |= (uint64_t)index << (3 * i);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    for(int i = 0; i < 6; i++) {
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+    }
+}
+
+void bs_encodePixels(unsigned char *src, unsigned char *dst, int count, bs_TexFormat format) {
+    switch(format) {
+        case BS_TEX_RGBA8:
+            memcpy(dst, src, count * 4); break;
+        case BS_TEX_R8:
+            for(int i = 0; i < count; i++) {
+                dst[i] = src[i * 4 + 3];
+            }
+            break;
+        case BS_TEX_RG8:
+            for(int i = 0; i < count; i++) {
+                unsigned char *px = src + i * 4;
+                dst[i * 2 + 0] = (px[0] * 77 + px[1] * 150 + px[2] * 29) >> 8;
+                dst[i * 2 + 1] = px[3];
+            }
+            break;
+        case BS_TEX_RGB565:
+            for(int i = 0; i < count; i++) {
+                int rgb[3] = { src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2] };
+                uint16_t packed = bs_pack565(rgb);
+                memcpy(dst + i * 2, &packed, 2);
+            }
+            break;
+    }
+}
+
+// Encodes one row of 4x4 blocks (or 4 rows of pixels for uncompressed formats)
+void bs_encodeRow(int row, void *arg) {
+    bs_EncodeJob *job = arg;
+    const bs_TexFormatInfo *info = &tex_formats[job->format];
+
+    if(info->block_dim == 1) {
+        int end = cappend_MIN(row * 4 + 4, job->h);
+
+        for(int y = row * 4; y < end; y++) {
+            unsigned char *src = job->src + 4 * y * job->w;
+            unsigned char *dst = job->dst + (size_t)y * job->w * info->block_bytes;
+            bs_encodePixels(src, dst, job->w, job->format);
+        }
+        return;
+    }
+
+    int blocks_x = (job->w + 3) / 4;
+    unsigned char *out = job->dst + (size_t)row * blocks_x * info->block_bytes;
+
+    for(int bx = 0; bx < blocks_x; bx++, out += info->block_bytes) {
+        unsigned char block[16][4];
+        bs_fetchBlock(job->src, job->w, job->h, bx, row, block);
+
+        if(job->format == BS_TEX_BC3) {
+            bs_encodeAlphaBlock(block, out);
+            bs_encodeColorBlock(block, out + 8, false);
+        } else {
+            bs_encodeColorBlock(block, out, true);
+        }
+    }
+}
+
+// Box filters one row of the next mip level
+void bs_downsampleRow(int y, void *arg) {
+    bs_EncodeJob *job = arg;
+    int y0 = cappend_MIN(y * 2 + 0, job->h - 1);
+    int y1 = cappend_MIN(y * 2 + 1, job->h - 1);
+
+    unsigned char *dst = job->dst + 4 * y * job->dst_w;
+    for(int x = 0; x < job->dst_w; x++) {
+        int x0 = cappend_MIN(x * 2 + 0, job->w - 1);
+        int x1 = cappend_MIN(x * 2 + 1, job->w - 1);
+
+        unsigned char *p00 = job->src + 4 * (y0 * job->w + x0);
+        unsigned char *p01 = job->src + 4 * (y0 * job->w + x1);
+        unsigned char *p10 = job->src + 4 * (y1 * job->w + x0);
+        unsigned char *p11 = job->src + 4 * (y1 * job->w + x1);
+
+        for(int c = 0; c < 4; c++) {
+            dst[x * 4 + c] = (p00[c] + p01[c] + p10[c] + p11[c] + 2) >> 2;
+        }
+    }
+}
+
+bool bs_readAtlasCache(bs_Atlas *atlas, uint64_t hash) {
+    if(atlas->cache_path == NULL)
+        return false;
+
+    FILE *f = fopen(atlas->cache_path, "rb");
+    if(f == NULL)
+        return false;
+
+    bs_AtlasCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.magic, "BSAT", 4) == 0 &&
+        header.version == BS_ATLAS_CACHE_VERSION &&
+        header.w == atlas->w && header.h == atlas->h &&
+        header.format == atlas->format &&
+        header.level_count == atlas->level_count &&
+        header.hash == hash &&
+        header.size == atlas->baked_size;
+
+    if(valid) {
+        atlas->baked = malloc(atlas->baked_size);
+        valid = fread(atlas->baked, 1, atlas->baked_size, f) == atlas->baked_size;
+
+        if(!valid) {
+            free(atlas->baked);
+            atlas->baked = NULL;
+        }
+    }
+
+    fclose(f);
+    return valid;
+}
+
+void bs_writeAtlasCache(bs_Atlas *atlas, uint64_t hash) {
+    if(atlas->cache_path == NULL)
+        return;
+
+    FILE *f = fopen(atlas->cache_path, "wb");
+    if(f == NULL) {
+        printf("Atlas cache couldn't be written: %s\n", atlas->cache_path);
+        return;
+    }
+
+    bs_AtlasCacheHeader header = { { 'B', 'S', 'A', 'T' }, BS_ATLAS_CACHE_VERSION,
+        atlas->w, atlas->h, atlas->format, atlas->level_count, hash, atlas->baked_size };
+
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(atlas->baked, 1, atlas->baked_size, f);
+    fclose(f);
+}
+
+// Reads the mip chain from first_level onwards back from the cache
+unsigned char *bs_readAtlasLevels(bs_Atlas *atlas, int first_level) {
+    if(atlas->cache_path == NULL)
+        return NULL;
+
+    FILE *f = fopen(atlas->cache_path, "rb");
+    if(f == NULL)
+        return NULL;
+
+    bs_AtlasCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+        header.version == BS_ATLAS_CACHE_VERSION &&
+        header.hash == atlas->content_hash &&
+        header.size == atlas->baked_size;
+
+    size_t size = atlas->baked_size - atlas->level_offsets[first_level];
+    unsigned char *levels = NULL;
+
+    if(valid && fseek(f, sizeof(header) + atlas->level_offsets[first_level], SEEK_SET) == 0) {
+        levels = malloc(size);
+
+        if(fread(levels, 1, size, f) != size) {
+            free(levels);
+            levels = NULL;
+        }
+    }
+
+    fclose(f);
+    return levels;
+}
+
+// Builds the full mip chain in the atlas format, or reads it from the cache
+void bs_bakeAtlas(bs_Atlas *atlas) {
+    atlas->level_count = 0;
+    atlas->baked_size = 0;
+
+    for(int i = 0; i < BS_MAX_MIP_LEVELS; i++) {
+        int lw = bs_getLevelDim(atlas->w, i);
+        int lh = bs_getLevelDim(atlas->h, i);
+
+        atlas->level_offsets[atlas->level_count++] = atlas->baked_size;
+        atlas->baked_size += bs_getFormatSize(atlas->format, lw, lh);
+
+        if(lw == 1 && lh == 1)
+            break;
+    }
+
+    uint64_t hash = bs_hash64(atlas->data, (size_t)atlas->w * atlas->h * 4, atlas->format);
+    atlas->content_hash = hash;
+
+    if(bs_readAtlasCache(atlas, hash))
+        return;
+
+    atlas->baked = malloc(atlas->baked_size);
+    unsigned char *level = atlas->data;
+
+    for(int i = 0; i < atlas->level_count; i++) {
+        int lw = bs_getLevelDim(atlas->w, i);
+        int lh = bs_getLevelDim(atlas->h, i);
+
+        bs_EncodeJob job = { level, atlas->baked + atlas->level_offsets[i], lw, lh, 0, atlas->format };
+        bs_parallelFor((lh + 3) / 4, bs_encodeRow, &job);
+
+        if(i + 1 == atlas->level_count)
+            break;
+
+        int next_w = bs_getLevelDim(atlas->w, i + 1);
+        int next_h = bs_getLevelDim(atlas->h, i + 1);
+        unsigned char *next = malloc(4 * next_w * next_h);
+
+        bs_EncodeJob mip_job = { level, next, lw, lh, next_w, atlas->format };
+        bs_parallelFor(next_h, bs_downsampleRow, &mip_job);
+
+        if(level != atlas->data)
+            free(level);
+        level = next;
+    }
+
+    if(level != atlas->data)
+        free(level);
+
+    bs_writeAtlasCache(atlas, hash);
+}
+
+void bs_splitTexture(unsigned char *data, int w, int h, int frames, bs_Tex2D *textures) {
     int slice_width = w / frames; // TODO: Check if not an int
 
     // For each frame
     for(int i = 0; i < frames; i++) {
-        bs_Tex2D *tex = (*textures) + *curr_tex_count + i;
+        bs_Tex2D *tex = &textures[i];
         tex->w = w;
         tex->h = h;
         tex->x = 0;
         tex->y = 0;
+        tex->tex_x = tex->tex_y = 0.0;
+        tex->tex_wx = tex->tex_hy = 0.0;
+        tex->last_used = 0;
 
-        int row_size_slice = 4 * slice_width;
-        int row_size_full = 4 * w;
-        tex->data = malloc(4 * slice_width * h);
-
-        // For each horizontal slice
-        for(int j = 0; j < h; j++) {
-            int write_offset = j * row_size_slice;
-            int read_offset = j * row_size_full;
-            read_offset += i * row_size_slice;
-            memcpy(tex->data + write_offset, data + read_offset, row_size_slice);
-        }
+        unsigned char *slice = data + 4 * i * slice_width;
         cappend_ImgInfo img_info;
 
-        cappend_getMinimumTextureSize(tex->data, slice_width, tex->h, &img_info);
-        cappend_removePixelsByExtent(&tex->data, slice_width, tex->h, &img_info);
+        // Frames keep referencing the sheet, trimming only moves the bounds
+        cappend_getMinimumTextureSizeStrided(slice, slice_width, h, w, &img_info);
 
+        tex->data = slice + 4 * (img_info.top * w + img_info.left);
+        tex->data_stride = w;
         tex->w = img_info.w;
         tex->h = img_info.h;
     }
 }
 
-void bs_setOffsets(int width, int height, bs_Atlas *atlas) {
+uint64_t bs_hashTexture(bs_Tex2D *tex) {
+    uint64_t hash = ((uint64_t)tex->w << 32) | tex->h;
+
+    for(int y = 0; y < tex->h; y++) {
+        hash = bs_hash64(tex->data + 4 * y * tex->data_stride, 4 * tex->w, hash);
+    }
+
+    return hash;
+}
+
+bool bs_compareTextures(bs_Tex2D *a, bs_Tex2D *b) {
+    if(a->w != b->w || a->h != b->h)
+        return false;
+
+    for(int y = 0; y < a->h; y++) {
+        if(memcmp(a->data + 4 * y * a->data_stride, b->data + 4 * y * b->data_stride, 4 * a->w) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// Sets alias[i] to the first texture with the same pixels as texture i (or i itself)
+void bs_findDuplicates(bs_Atlas *atlas, int *alias) {
+    // The stats only describe this pack
+    atlas->dedup_count = 0;
+    atlas->dedup_bytes_saved = 0;
+
+    int table_size = 1;
+    while(table_size < atlas->tex_count * 2) {
+        table_size <<= 1;
+    }
+
+    int *table = malloc(sizeof(int) * table_size);
+    uint64_t *hashes = malloc(sizeof(uint64_t) * atlas->tex_count);
+    memset(table, -1, sizeof(int) * table_size);
+
+    for(int i = 0; i < atlas->tex_count; i++) {
+        bs_Tex2D *tex = atlas->textures[i];
+        alias[i] = i;
+
+        if(tex->w == 0 || tex->h == 0)
+            continue;
+
+        hashes[i] = bs_hashTexture(tex);
+        int slot = hashes[i] & (table_size - 1);
+
+        // Equal hashes are confirmed by comparing the pixels
+        while(table[slot] != -1) {
+            int j = table[slot];
+
+            if(hashes[j] == hashes[i] && bs_compareTextures(atlas->textures[j], tex)) {
+                alias[i] = j;
+                break;
+            }
+
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if(alias[i] == i) {
+            table[slot] = i;
+        } else {
+            atlas->dedup_count++;
+            atlas->dedup_bytes_saved += 4 * tex->w * tex->h;
+        }
+    }
+
+    free(table);
+    free(hashes);
+}
+
+// The white square sits in the bottom right corner of the atlas
+bool bs_overlapsWhiteSquare(rectpacker_Rect *rects, int rect_count, int width, int height) {
+    int corner_x = width - BS_WHITE_SQUARE_DIM;
+    int corner_y = height - BS_WHITE_SQUARE_DIM;
+
+    for(int i = 0; i < rect_count; i++) {
+        if(rects[i].w == 0 || rects[i].h == 0)
+            continue;
+
+        if(rects[i].x + rects[i].w > corner_x && rects[i].y + rects[i].h > corner_y)
+            return true;
+    }
+
+    return false;
+}
+
+// Packs the textures and shrinks the atlas to the smallest power of two they fit in
+void bs_setOffsets(bs_Atlas *atlas) {
     rectpacker_Rect *rects = malloc(sizeof(rectpacker_Rect) * atlas->tex_count);
-    bs_Tex2D *tex = atlas->textures;
+    int *alias = malloc(sizeof(int) * atlas->tex_count);
+    bs_Tex2D **tex = atlas->textures;
+
+    bs_findDuplicates(atlas, alias);
 
+    // Duplicates don't take up any space of their own
     for(int i = 0; i < atlas->tex_count; i++) {
-        rects[i].w = tex[i].w;
-        rects[i].h = tex[i].h;
+        bool unique = alias[i] == i;
+        rects[i].w = unique ? tex[i]->w : 0;
+        rects[i].h = unique ? tex[i]->h : 0;
     }
 
-    rectpacker_packRect(rects, atlas->tex_count, width, height);
+    int width  = BS_MIN(BS_MIN_ATLAS_DIM, atlas->max_w);
+    int height = BS_MIN(BS_MIN_ATLAS_DIM, atlas->max_h);
+
+    for(;;) {
+        bool fits = rectpacker_packRect(rects, atlas->tex_count, width, height) == 0 &&
+            !bs_overlapsWhiteSquare(rects, atlas->tex_count, width, height);
+
+        // Textures that don't fit the largest size are left out below
+        if(fits || (width == atlas->max_w && height == atlas->max_h))
+            break;
+
+        if(height < atlas->max_h && (height < width || width == atlas->max_w)) {
+            height = BS_MIN(height * 2, atlas->max_h);
+        } else {
+            width = BS_MIN(width * 2, atlas->max_w);
+        }
+    }
+
+    atlas->w = width;
+    atlas->h = height;
 
     for(int i = 0; i < atlas->tex_count; i++) {
-        tex[i].x = rects[i].x;
-        tex[i].y = rects[i].y;
-        tex[i].tex_x = rects[i].tex_x;
-        tex[i].tex_y = rects[i].tex_y;
-        tex[i].tex_wx = rects[i].tex_x + rects[i].w / (float)width;
-        tex[i].tex_hy = rects[i].tex_y + rects[i].h / (float)height;
+        if(alias[i] != i) {
+            // Originals always come first, their placement is already set
+            bs_Tex2D *original = tex[alias[i]];
+            tex[i]->x = original->x;
+            tex[i]->y = original->y;
+            tex[i]->tex_x = original->tex_x;
+            tex[i]->tex_y = original->tex_y;
+            tex[i]->tex_wx = original->tex_wx;
+            tex[i]->tex_hy = original->tex_hy;
+            tex[i]->data = NULL;
+            continue;
+        }
+
+        // Left unpacked, bs_appendToAtlas skips it and its rect stays empty
+        if(!rects[i].placed && rects[i].w != 0 && rects[i].h != 0) {
+            printf("Texture of %dx%d doesn't fit the atlas and was left out\n", tex[i]->w, tex[i]->h);
+            tex[i]->data = NULL;
+            continue;
+        }
+
+        tex[i]->x = rects[i].x;
+        tex[i]->y = rects[i].y;
+        tex[i]->tex_x = rects[i].tex_x;
+        tex[i]->tex_y = rects[i].tex_y;
+        tex[i]->tex_wx = rects[i].tex_x + rects[i].w / (float)width;
+        tex[i]->tex_hy = rects[i].tex_y + rects[i].h / (float)height;
     }
+
+    free(rects);
+    free(alias);
 }
 
 void bs_appendToAtlas(unsigned char *atlas_data, int width, int height, bs_Atlas *atlas) {
     for(int i = 0; i < atlas->tex_count; i++) {
-        bs_Tex2D *tex = &atlas->textures[i];
-        cappend_append(atlas_data, width, height, tex->data, tex->w, tex->h, tex->x, tex->y);
-        free(tex->data);
+        bs_Tex2D *tex = atlas->textures[i];
+
+        // Duplicates share the placement of another texture
+        if(tex->data == NULL)
+            continue;
+
+        cappend_appendStrided(atlas_data, width, height, tex->data, tex->w, tex->h, tex->data_stride, tex->x, tex->y);
         tex->data = NULL;
     }
+
+    for(int i = 0; i < atlas->sheet_count; i++) {
+        free(atlas->sheets[i]);
+    }
+
+    free(atlas->sheets);
+    atlas->sheets = NULL;
+    atlas->sheet_count = 0;
 }
 
 void bs_createWhiteSquare(int dim, bs_Atlas *atlas) {
@@ -92,62 +657,251 @@ void bs_createWhiteSquare(int dim, bs_Atlas *atlas) {
     }
 }
 
+// Adds a texture to the atlas, the texture itself has to stay where it is
+void bs_addAtlasTexture(bs_Atlas *atlas, bs_Tex2D *tex) {
+    if(atlas->tex_count == atlas->tex_capacity) {
+        atlas->tex_capacity = BS_MAX(atlas->tex_capacity * 2, 16);
+        atlas->textures = realloc(atlas->textures, sizeof(bs_Tex2D *) * atlas->tex_capacity);
+    }
+
+    tex->atlas_id = atlas->id;
+    atlas->textures[atlas->tex_count++] = tex;
+}
+
+// width and height are the largest the atlas can grow to, nothing is allocated
+// for the pixels until the atlas is pushed and its final size is known
 bs_Atlas *bs_createTextureAtlas(int width, int height, int max_textures) {
-    atlases = realloc(atlases, sizeof(bs_Atlas) * (atlas_count+1));
-    bs_Atlas *atlas = &atlases[atlas_count];
+    // Atlases are allocated separately so pointers to them stay valid
+    atlases = realloc(atlases, sizeof(bs_Atlas *) * (atlas_count+1));
+    bs_Atlas *atlas = atlases[atlas_count] = malloc(sizeof(bs_Atlas));
 
-    atlas->data = calloc(width * height * 4, sizeof(char));
-    atlas->textures = malloc(sizeof(bs_Tex2D) * max_textures);
+    atlas->data = NULL;
     atlas->w = width;
     atlas->h = height;
+    atlas->max_w = width;
+    atlas->max_h = height;
     atlas->id = atlas_count;
-    atlas->tex_count = 0;
 
-    // White square can be used as default texture
-    // allows multiplication of textures with color-only primitives
-    bs_createWhiteSquare(BS_ATLAS_SIZE / 128, atlas);
+    // max_textures is only a hint, the list grows as needed
+    atlas->textures = malloc(sizeof(bs_Tex2D *) * max_textures);
+    atlas->tex_capacity = max_textures;
+    atlas->tex_count = 0;
+    atlas->sheets = NULL;
+    atlas->sheet_count = 0;
+    atlas->pushed = false;
+    atlas->dedup_count = 0;
+    atlas->dedup_bytes_saved = 0;
+
+    atlas->format = BS_TEX_RGBA8;
+    atlas->cache_path = NULL;
+    atlas->baked = NULL;
+    atlas->baked_size = 0;
+    atlas->level_count = 0;
+    atlas->content_hash = 0;
+
+    atlas->resident_level = -1;
+    atlas->last_used = 0;
+    atlas->pending_tex_id = 0;
+    atlas->pending_level = -1;
+    atlas->restore_requested = false;
+    atlas->restore_failed = false;
 
     atlas_count++;
 
     return atlas;
 }
 
-void bs_pushAtlas(bs_Atlas *atlas) {
-    bs_setOffsets(atlas->w, atlas->h, atlas);
-    bs_appendToAtlas(atlas->data, atlas->w, atlas->h, atlas);
+void bs_setAtlasFormat(bs_Atlas *atlas, bs_TexFormat format) {
+    atlas->format = format;
+}
+
+// Baked mip chains are stored at path and reused while the atlas contents don't change
+void bs_setAtlasCache(bs_Atlas *atlas, char *path) {
+    atlas->cache_path = path;
+    atlas->restore_failed = false;
+}
 
-    glGenTextures(1, &atlas->tex_id);
+int bs_getAtlasCount() {
+    return atlas_count;
+}
+
+bs_Atlas *bs_getAtlas(int id) {
+    return atlases[id];
+}
+
+// Size of the mip chain from first_level onwards
+size_t bs_getAtlasLevelBytes(bs_Atlas *atlas, int first_level) {
+    return atlas->baked_size - atlas->level_offsets[first_level];
+}
+
+// Creates texture storage for the mip chain starting at first_level
+unsigned int bs_createAtlasTexture(bs_Atlas *atlas, int first_level) {
+    const bs_TexFormatInfo *info = &tex_formats[atlas->format];
+    unsigned int tex_id;
+
+    // The atlas unit keeps its current texture, it's only replaced once the uploads finish
+    GLint prev_unit, prev_tex;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &prev_unit);
     glActiveTexture(GL_TEXTURE0 + atlas->id);
-    glBindTexture(GL_TEXTURE_2D, atlas->tex_id);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &prev_tex);
+
+    glGenTextures(1, &tex_id);
+    glBindTexture(GL_TEXTURE_2D, tex_id);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->w, atlas->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas->data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // Contents are filled in by the upload queue
+    for(int i = first_level; i < atlas->level_count; i++) {
+        int lw = bs_getLevelDim(atlas->w, i);
+        int lh = bs_getLevelDim(atlas->h, i);
+
+        if(info->block_dim == 1) {
+            glTexImage2D(GL_TEXTURE_2D, i - first_level, info->internal_format, lw, lh, 0, info->format, info->type, NULL);
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i - first_level, info->internal_format, lw, lh, 0, bs_getFormatSize(atlas->format, lw, lh), NULL);
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, atlas->level_count - 1 - first_level);
+
+    // Single and dual channel formats sample as tinted white so the standard shaders work
+    GLint alpha_swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+    GLint luminance_swizzle[] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+
+    if(atlas->format == BS_TEX_R8)
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, alpha_swizzle);
+    if(atlas->format == BS_TEX_RG8)
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, luminance_swizzle);
+
+    glBindTexture(GL_TEXTURE_2D, prev_tex);
+    glActiveTexture(prev_unit);
+
+    return tex_id;
 }
 
-bs_Tex2D *bs_loadTexture(char *path, int frames) {
-    // printf(path);
-    // printf("\n");
+// Switches the atlas over to its pending texture once all levels are uploaded
+void bs_swapAtlasTexture(void *arg) {
+    bs_Atlas *atlas = arg;
+
+    if(atlas->resident_level >= 0)
+        glDeleteTextures(1, &atlas->tex_id);
+
+    atlas->tex_id = atlas->pending_tex_id;
+    atlas->resident_level = atlas->pending_level;
+    atlas->pending_tex_id = 0;
+    atlas->pending_level = -1;
+
+    // Rebinds the atlas unit, it held the old texture
+    GLint prev_unit;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &prev_unit);
+    glActiveTexture(GL_TEXTURE0 + atlas->id);
+    glBindTexture(GL_TEXTURE_2D, atlas->tex_id);
+    glActiveTexture(prev_unit);
+}
+
+// Queues the mip chain starting at first_level into a new texture, levels points to the
+// data of first_level and is owned (and freed) by the upload queue from here on
+void bs_streamAtlasLevels(bs_Atlas *atlas, unsigned char *levels, int first_level) {
+    atlas->pending_tex_id = bs_createAtlasTexture(atlas, first_level);
+    atlas->pending_level = first_level;
+
+    for(int i = first_level; i < atlas->level_count; i++) {
+        int lw = bs_getLevelDim(atlas->w, i);
+        int lh = bs_getLevelDim(atlas->h, i);
+        unsigned char *level = levels + atlas->level_offsets[i] - atlas->level_offsets[first_level];
+
+        // Levels are sent in order, so the last one finishing means the chain is complete
+        if(i + 1 == atlas->level_count) {
+            bs_queueUpload(atlas->pending_tex_id, i - first_level, lw, lh, atlas->format, level, bs_swapAtlasTexture, atlas, levels);
+        } else {
+            bs_queueUpload(atlas->pending_tex_id, i - first_level, lw, lh, atlas->format, level, NULL, NULL, NULL);
+        }
+    }
+}
+
+void bs_pushAtlas(bs_Atlas *atlas) {
+    // The pixels of the packed textures are gone, repacking them would leave their rects empty
+    if(atlas->pushed) {
+        printf("Atlas %d was already pushed\n", atlas->id);
+        return;
+    }
+
+    bs_setOffsets(atlas);
+
+    free(atlas->data);
+    atlas->data = calloc((size_t)atlas->w * atlas->h * 4, sizeof(char));
+
+    // White square can be used as default texture
+    // allows multiplication of textures with color-only primitives
+    bs_createWhiteSquare(BS_WHITE_SQUARE_DIM, atlas);
+
+    bs_appendToAtlas(atlas->data, atlas->w, atlas->h, atlas);
+    bs_bakeAtlas(atlas);
+
+    // The upload queue takes over the baked data
+    bs_streamAtlasLevels(atlas, atlas->baked, 0);
+    atlas->baked = NULL;
+    atlas->last_used = 0;
+    atlas->restore_requested = false;
+    atlas->restore_failed = false;
+    atlas->pushed = true;
+}
+
+// Splits a decoded sheet into its frames and queues them for the standard atlas
+bs_Tex2D *bs_addTextureSheet(unsigned char *data, unsigned int w, unsigned int h, int frames) {
     bs_Atlas *std_atlas = bs_getStdAtlas();
 
-    bs_Tex2D *tex = std_atlas->textures + std_atlas->tex_count;
+    // Frames of a texture are contiguous, the atlas only keeps pointers to them
+    bs_Tex2D *tex = malloc(sizeof(bs_Tex2D) * frames);
+
+    bs_splitTexture(data, w, h, frames, tex);
+
+    // The decoded image lives until the atlas is built
+    pthread_mutex_lock(&load_mutex);
+    std_atlas->sheets = realloc(std_atlas->sheets, sizeof(unsigned char *) * (std_atlas->sheet_count + 1));
+    std_atlas->sheets[std_atlas->sheet_count++] = data;
+
+    for(int i = 0; i < frames; i++) {
+        bs_addAtlasTexture(std_atlas, &tex[i]);
+    }
+    pthread_mutex_unlock(&load_mutex);
+
+    return tex;
+}
+
+bs_Tex2D *bs_loadTexture(char *path, int frames) {
     unsigned char *data;
+    unsigned int w, h;
 
-    int success = lodepng_decode32_file(&data, &tex->w, &tex->h, path);
+    int success = lodepng_decode32_file(&data, &w, &h, path);
 
     if(success != 0) {
         printf("Texture wasn't loaded: %d\n", success);
     }
 
-    bs_splitTexture(data, tex->w, tex->h, frames, &std_atlas->tex_count, &std_atlas->textures);
+    return bs_addTextureSheet(data, w, h, frames);
+}
 
-    std_atlas->tex_count += frames;
+// Same as bs_loadTexture for a PNG that's already in memory, like one embedded in a model
+bs_Tex2D *bs_loadTextureData(const unsigned char *png, size_t size, int frames) {
+    unsigned char *data;
+    unsigned int w, h;
 
-    return tex;
+    int success = lodepng_decode32(&data, &w, &h, png, size);
+
+    if(success != 0) {
+        printf("Texture wasn't decoded: %d\n", success);
+    }
+
+    return bs_addTextureSheet(data, w, h, frames);
+}
+
+// The atlas rect is only set once the atlas is pushed, until then it's empty
+bool bs_isTexturePacked(bs_Tex2D *tex) {
+    return tex->tex_wx > tex->tex_x && tex->tex_hy > tex->tex_y;
 }
 
 void bs_selectTexture(bs_Tex2D *texture) {
@@ -160,9 +914,15 @@ void bs_saveAtlasToFile(bs_Atlas *atlas, char *name) {
 
 void bs_freeAtlasData(bs_Atlas *atlas) {
     free(atlas->data);
+    free(atlas->baked);
+    atlas->data = NULL;
+    atlas->baked = NULL;
 }
 
 void bs_selectAtlas(bs_Atlas *atlas) {
+    // Streams the atlas back in if it was evicted or downgraded
+    bs_markAtlasUsed(atlas);
+
     // glActiveTexture(GL_TEXTURE0 + atlas->id);
     glBindTexture(GL_TEXTURE_2D, atlas->tex_id);
 }
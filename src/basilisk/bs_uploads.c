@@ -0,0 +1,149 @@
+// GL
+#include <glad/glad.h>
+
+// Basilisk
+#include <bs_textures.h>
+#include <bs_uploads.h>
+#include <bs_math.h>
+
+// STD
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef struct {
+    unsigned int pbo;
+    GLsync fence;
+} bs_UploadSlot;
+
+bs_UploadSlot upload_ring[BS_UPLOAD_RING_SIZE];
+bool upload_ring_created = false;
+int upload_ring_index = 0;
+
+bs_Upload *uploads = NULL;
+int upload_head = 0;
+int upload_count = 0;
+int upload_cap = 0;
+
+size_t upload_budget = BS_UPLOAD_DEFAULT_BUDGET;
+
+void bs_createUploadRing() {
+    for(int i = 0; i < BS_UPLOAD_RING_SIZE; i++) {
+        glGenBuffers(1, &upload_ring[i].pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_ring[i].pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, BS_UPLOAD_PBO_BYTES, NULL, GL_STREAM_DRAW);
+        upload_ring[i].fence = NULL;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    upload_ring_created = true;
+}
+
+void bs_queueUpload(unsigned int tex_id, int level, int w, int h, bs_TexFormat format, unsigned char *data,
+                    void (*done)(void *arg), void *arg, void *free_ptr) {
+    if(upload_count == upload_cap) {
+        upload_cap = upload_cap == 0 ? 16 : upload_cap * 2;
+        uploads = realloc(uploads, upload_cap * sizeof(bs_Upload));
+    }
+
+    uploads[upload_count++] = (bs_Upload){ tex_id, level, w, h, format, data, 0, done, arg, free_ptr };
+}
+
+void bs_setUploadBudget(size_t bytes_per_frame) {
+    upload_budget = bytes_per_frame;
+}
+
+int bs_getPendingUploadCount() {
+    return upload_count - upload_head;
+}
+
+// Sends rows through the PBO ring until the budget is spent
+// Without wait, it stops at the first PBO the GPU is still reading from
+void bs_sendUploads(size_t budget, bool wait) {
+    if(!upload_ring_created)
+        bs_createUploadRing();
+
+    // Rows of the smaller formats aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // Uploads bind on their own unit so the atlas and palette bindings stay as they are
+    GLint prev_unit;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &prev_unit);
+    glActiveTexture(GL_TEXTURE0 + BS_UPLOAD_UNIT);
+
+    while(upload_head < upload_count && budget > 0) {
+        bs_UploadSlot *slot = &upload_ring[upload_ring_index];
+
+        if(slot->fence != NULL) {
+            GLenum status = glClientWaitSync(slot->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+            if(status == GL_TIMEOUT_EXPIRED)
+                break;
+
+            glDeleteSync(slot->fence);
+            slot->fence = NULL;
+        }
+
+        bs_Upload *up = &uploads[upload_head];
+        const bs_TexFormatInfo *info = bs_getFormatInfo(up->format);
+
+        // A row here is a row of blocks for compressed formats
+        int total_rows = (up->h + info->block_dim - 1) / info->block_dim;
+        size_t row_bytes = bs_getFormatSize(up->format, up->w, info->block_dim);
+
+        int rows = total_rows - up->next_row;
+        rows = BS_MIN(rows, BS_UPLOAD_PBO_BYTES / row_bytes);
+        rows = BS_MIN(rows, BS_MAX(1, budget / row_bytes));
+        size_t size = rows * row_bytes;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo);
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        memcpy(dst, up->data + up->next_row * row_bytes, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        int y = up->next_row * info->block_dim;
+        int h = BS_MIN(rows * info->block_dim, up->h - y);
+
+        glBindTexture(GL_TEXTURE_2D, up->tex_id);
+        if(info->block_dim == 1) {
+            glTexSubImage2D(GL_TEXTURE_2D, up->level, 0, y, up->w, h, info->format, info->type, (void*)0);
+        } else {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, up->level, 0, y, up->w, h, info->internal_format, size, (void*)0);
+        }
+
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        upload_ring_index = (upload_ring_index + 1) % BS_UPLOAD_RING_SIZE;
+
+        up->next_row += rows;
+        budget -= BS_MIN(budget, size);
+
+        if(up->next_row == total_rows) {
+            upload_head++;
+
+            if(up->done != NULL)
+                up->done(up->arg);
+            free(up->free_ptr);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glActiveTexture(prev_unit);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if(upload_head == upload_count) {
+        upload_head = 0;
+        upload_count = 0;
+    }
+}
+
+// Called once per frame, sends at most the upload budget
+void bs_processUploads() {
+    if(upload_head < upload_count)
+        bs_sendUploads(upload_budget, false);
+}
+
+// Sends everything that is queued, blocking on the GPU if necessary
+void bs_flushUploads() {
+    while(upload_head < upload_count) {
+        bs_sendUploads((size_t)-1, true);
+    }
+}
\ No newline at end of file